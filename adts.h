@@ -0,0 +1,66 @@
+#ifndef ADTS_H
+#define ADTS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/* 相关blog文档链接：https://www.cnblogs.com/vczf/p/13553149.html */
+
+// 支持的AAC采样频率数组，用于ADTS头部的生成
+static const int sampling_frequencies[] = {
+    96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000
+};
+
+// 生成ADTS头部的函数，用于在写入AAC数据前添加ADTS头部
+static int adts_header(char* const p_adts_header, const int data_length,
+                       const int profile, const int samplerate,
+                       const int channels) {
+
+    // 默认采样频率索引为48000Hz
+    int sampling_frequency_index = 3; 
+    int adtsLen = data_length + 7; // ADTS头部长度为7字节
+
+    // 确定采样频率在数组中的索引
+    int frequencies_size = sizeof(sampling_frequencies) / sizeof(sampling_frequencies[0]);
+    int i = 0;
+    for (i = 0; i < frequencies_size; i++) {
+        if (sampling_frequencies[i] == samplerate) {
+            sampling_frequency_index = i;
+            break;
+        }
+    }
+    if (i >= frequencies_size) {
+        printf("Unsupported samplerate: %d\n", samplerate);
+        return -1;
+    }
+
+    // 填充ADTS头部信息
+    p_adts_header[0] = 0xff; // 同步字1
+    p_adts_header[1] = 0xf1; // 同步字2, MPEG-4, Layer, protection absent
+    p_adts_header[2] = (profile << 6) | (sampling_frequency_index << 2) | ((channels & 0x04) >> 2);
+    p_adts_header[3] = ((channels & 0x03) << 6) | (adtsLen >> 11);
+    p_adts_header[4] = (adtsLen & 0x7f8) >> 3;
+    p_adts_header[5] = ((adtsLen & 0x07) << 5) | 0x1f;
+    p_adts_header[6] = 0xfc;
+
+    return 0;
+}
+
+// 解析 ADTS 头，成功时返回整个帧（含头）的字节数，并给出采样率和该帧的采样数（每声道）；
+// 不是合法的 ADTS 头时返回 -1。只读头部7字节，可以用来不解码地逐帧跳过
+static int adts_parse_header(const uint8_t *p, size_t size, int *samplerate, int *samples) {
+    if (size < 7 || p[0] != 0xff || (p[1] & 0xf6) != 0xf0)
+        return -1;
+    int sampling_frequency_index = (p[2] >> 2) & 0x0f;
+    if (sampling_frequency_index >= (int)(sizeof(sampling_frequencies) / sizeof(sampling_frequencies[0])))
+        return -1;
+    int frame_length = ((p[3] & 0x03) << 11) | (p[4] << 3) | (p[5] >> 5);
+    if (frame_length < 7)
+        return -1;
+    *samplerate = sampling_frequencies[sampling_frequency_index];
+    *samples = ((p[6] & 0x03) + 1) * 1024; // 每个原始数据块1024个采样
+    return frame_length;
+}
+
+#endif // ADTS_H
@@ -0,0 +1,367 @@
+#include <SDL2/SDL.h>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <functional>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include "simd_kernels.h"
+#include "adts.h"
+
+/* 逐帧内核的微基准：在合成数据上分别测量各内核，比较标量与向量化实现 */
+
+struct Resolution {
+    int width;
+    int height;
+};
+
+const Resolution resolutions[] = {{640, 360}, {1280, 720}, {1920, 1080}, {3840, 2160}};
+const int channel_counts[] = {1, 2, 6, 8};
+const int AUDIO_FRAME_SAMPLES = 1024; // 一个AAC帧的采样数
+
+static int g_reps = 10;
+static const char *g_filter = nullptr;
+
+// 阻止编译器把基准中的结果当成无用代码优化掉
+static inline void clobber(const void *p) {
+    asm volatile("" : : "g"(p) : "memory");
+}
+
+// 填充可复现的伪随机数据
+static void fill_random(uint8_t *buf, size_t size, uint32_t seed) {
+    for (size_t i = 0; i < size; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        buf[i] = seed >> 24;
+    }
+}
+
+// 运行一个基准：先标定迭代次数使单次测量约20毫秒，再重复测量求均值和标准差
+static void run_bench(const char *kernel, const char *variant, const std::string &params,
+                      double bytes_per_op, const std::function<void()> &fn) {
+    if (g_filter && !strstr(kernel, g_filter))
+        return;
+
+    typedef std::chrono::steady_clock clock;
+    long iters = 1;
+    while (true) {
+        auto t0 = clock::now();
+        for (long i = 0; i < iters; i++)
+            fn();
+        double ms = std::chrono::duration<double, std::milli>(clock::now() - t0).count();
+        if (ms >= 20.0 || iters >= (1L << 30))
+            break;
+        iters *= 2;
+    }
+
+    std::vector<double> samples;
+    for (int r = 0; r < g_reps; r++) {
+        auto t0 = clock::now();
+        for (long i = 0; i < iters; i++)
+            fn();
+        double ns = std::chrono::duration<double, std::nano>(clock::now() - t0).count();
+        samples.push_back(ns / iters);
+    }
+
+    double mean = 0, var = 0;
+    for (double s : samples)
+        mean += s;
+    mean /= samples.size();
+    for (double s : samples)
+        var += (s - mean) * (s - mean);
+    double stddev = samples.size() > 1 ? sqrt(var / (samples.size() - 1)) : 0.0;
+
+    printf("%-16s %-14s %-12s %14.1f %7.2f%% %9.2f\n", kernel, variant, params.c_str(),
+           mean, mean > 0 ? stddev / mean * 100.0 : 0.0, bytes_per_op / mean);
+    fflush(stdout);
+}
+
+// save_yuv 中 SaveFrame 的逐行拷贝：带行填充的解码帧 -> 紧凑的 yuv420p
+static void bench_save_frame(FILE *devnull) {
+    for (const Resolution &res : resolutions) {
+        const int w = res.width, h = res.height;
+        const int linesize[3] = {w + 64, w / 2 + 32, w / 2 + 32}; // 模拟解码器的行对齐填充
+        const int plane_h[3] = {h, h / 2, h / 2};
+        const int plane_w[3] = {w, w / 2, w / 2};
+        std::vector<uint8_t> planes[3];
+        for (int p = 0; p < 3; p++) {
+            planes[p].resize((size_t)linesize[p] * plane_h[p]);
+            fill_random(planes[p].data(), planes[p].size(), p + 1);
+        }
+        const size_t frame_bytes = (size_t)w * h * 3 / 2;
+        std::vector<uint8_t> out(frame_bytes);
+        std::string params = std::to_string(w) + "x" + std::to_string(h);
+
+        run_bench("save_frame", "fwrite-rows", params, frame_bytes, [&]() {
+            for (int p = 0; p < 3; p++)
+                for (int y = 0; y < plane_h[p]; y++)
+                    fwrite(planes[p].data() + (size_t)y * linesize[p], 1, plane_w[p], devnull);
+        });
+        run_bench("save_frame", "memcpy-rows", params, frame_bytes, [&]() {
+            uint8_t *dst = out.data();
+            for (int p = 0; p < 3; p++)
+                for (int y = 0; y < plane_h[p]; y++) {
+                    memcpy(dst, planes[p].data() + (size_t)y * linesize[p], plane_w[p]);
+                    dst += plane_w[p];
+                }
+            clobber(out.data());
+        });
+    }
+}
+
+// save_pcm 中把平面采样交错写出的循环
+static void bench_interleave(FILE *devnull) {
+    for (int channels : channel_counts) {
+        const int n = AUDIO_FRAME_SAMPLES;
+        std::vector<float> planar((size_t)channels * n);
+        fill_random(reinterpret_cast<uint8_t *>(planar.data()), planar.size() * sizeof(float), channels);
+        for (float &v : planar)
+            v = std::isfinite(v) ? fmodf(v, 1.0f) : 0.0f;
+        std::vector<const float *> src(channels);
+        for (int ch = 0; ch < channels; ch++)
+            src[ch] = planar.data() + (size_t)ch * n;
+        std::vector<float> out((size_t)channels * n);
+        const double bytes = (double)channels * n * sizeof(float);
+        std::string params = std::to_string(channels) + "ch";
+
+        run_bench("pcm_interleave", "fwrite-sample", params, bytes, [&]() {
+            for (int i = 0; i < n; i++)
+                for (int ch = 0; ch < channels; ch++)
+                    fwrite(src[ch] + i, 1, sizeof(float), devnull);
+        });
+        run_bench("pcm_interleave", "scalar", params, bytes, [&]() {
+            interleave_f32_c(src.data(), channels, n, out.data());
+            clobber(out.data());
+        });
+        run_bench("pcm_interleave", "sse2", params, bytes, [&]() {
+            interleave_f32_simd(src.data(), channels, n, out.data());
+            clobber(out.data());
+        });
+    }
+}
+
+// mp4_to_aac 中为每个包生成 ADTS 头
+static void bench_adts() {
+    char header[7];
+    int length = 0;
+    run_bench("adts_header", "scalar", "44100Hz", 7, [&]() {
+        adts_header(header, length++ & 0x1fff, 1, 44100, 2);
+        clobber(header);
+    });
+}
+
+// yuv_compare 使用的 PSNR/SSIM 内核
+static void bench_compare() {
+    for (const Resolution &res : resolutions) {
+        const int w = res.width, h = res.height;
+        std::vector<uint8_t> a((size_t)w * h), b((size_t)w * h);
+        fill_random(a.data(), a.size(), 7);
+        fill_random(b.data(), b.size(), 7);
+        for (size_t i = 0; i < b.size(); i += 13)
+            b[i] ^= 3;
+        std::string params = std::to_string(w) + "x" + std::to_string(h);
+        const double bytes = 2.0 * w * h;
+        volatile uint64_t sink = 0;
+
+        run_bench("psnr_sse", "scalar", params, bytes, [&]() {
+            uint64_t sum = 0;
+            for (int y = 0; y < h; y++)
+                sum += sse_line_c(a.data() + (size_t)y * w, b.data() + (size_t)y * w, w);
+            sink = sum;
+        });
+        run_bench("psnr_sse", "sse2", params, bytes, [&]() {
+            sink = sse_plane(a.data(), w, b.data(), w, w, h);
+        });
+
+        std::vector<int> sums((size_t)(w / 4) * 4);
+        int (*rows)[4] = reinterpret_cast<int (*)[4]>(sums.data());
+        run_bench("ssim_4x4", "scalar", params, bytes, [&]() {
+            for (int y = 0; y + 4 <= h; y += 4)
+                ssim_4x4_row_c(a.data() + (size_t)y * w, w, b.data() + (size_t)y * w, w, w / 4, rows);
+            clobber(sums.data());
+        });
+        run_bench("ssim_4x4", "sse2", params, bytes, [&]() {
+            for (int y = 0; y + 4 <= h; y += 4)
+                ssim_4x4_row_simd(a.data() + (size_t)y * w, w, b.data() + (size_t)y * w, w, w / 4, rows);
+            clobber(sums.data());
+        });
+        (void)sink;
+    }
+}
+
+// save_pcm 波形概览使用的峰值归约
+static void bench_peaks() {
+    const int n = 256;
+    std::vector<float> samples(AUDIO_FRAME_SAMPLES);
+    for (int i = 0; i < AUDIO_FRAME_SAMPLES; i++)
+        samples[i] = sinf(i * 0.01f);
+    const double bytes = (double)AUDIO_FRAME_SAMPLES * sizeof(float);
+
+    run_bench("peak_reduce", "scalar", "1024smp", bytes, [&]() {
+        float lo = INFINITY, hi = -INFINITY;
+        double sq = 0;
+        for (int i = 0; i < AUDIO_FRAME_SAMPLES; i += n)
+            peak_reduce_c(samples.data() + i, n, &lo, &hi, &sq);
+        clobber(&sq);
+    });
+    run_bench("peak_reduce", "sse2", "1024smp", bytes, [&]() {
+        float lo = INFINITY, hi = -INFINITY;
+        double sq = 0;
+        for (int i = 0; i < AUDIO_FRAME_SAMPLES; i += n)
+            peak_reduce_simd(samples.data() + i, n, &lo, &hi, &sq);
+        clobber(&sq);
+    });
+}
+
+// save_yuv --dedup 使用的帧哈希（Y平面），与逐字节比较上一帧对照
+static void bench_frame_hash() {
+    for (const Resolution &res : resolutions) {
+        const int w = res.width, h = res.height;
+        std::vector<uint8_t> a((size_t)w * h), b;
+        fill_random(a.data(), a.size(), 7);
+        b = a;
+        std::string params = std::to_string(w) + "x" + std::to_string(h);
+        const double bytes = (double)w * h;
+        volatile uint64_t sink = 0;
+
+        run_bench("frame_hash", "scalar", params, bytes, [&]() {
+            uint64_t acc[2] = {0, 0};
+            for (int y = 0; y < h; y++)
+                frame_hash_row_c(acc, a.data() + (size_t)y * w, w);
+            sink = acc[0] ^ acc[1];
+        });
+        run_bench("frame_hash", "sse2", params, bytes, [&]() {
+            sink = frame_hash_plane(a.data(), w, w, h, 0);
+        });
+        run_bench("frame_hash", "memcmp", params, bytes, [&]() {
+            sink = memcmp(a.data(), b.data(), a.size());
+        });
+        (void)sink;
+    }
+}
+
+// sdl_audio 多路混音：一次回调的缓冲区（4096帧立体声）
+static void bench_mix() {
+    const int n = 4096 * 2;
+    std::vector<int16_t> src(n), dst(n);
+    fill_random(reinterpret_cast<uint8_t *>(src.data()), src.size() * sizeof(int16_t), 7);
+    const double bytes = (double)n * sizeof(int16_t);
+    const int16_t gain = 3 << 12; // 0.75
+
+    run_bench("pcm_mix", "scalar", "4096x2", bytes, [&]() {
+        mix_s16_c(dst.data(), src.data(), n, gain);
+        clobber(dst.data());
+    });
+    run_bench("pcm_mix", "sse2", "4096x2", bytes, [&]() {
+        mix_s16_simd(dst.data(), src.data(), n, gain);
+        clobber(dst.data());
+    });
+}
+
+// sdl_video 中的 YUV 纹理上传，使用 dummy 视频驱动和软件渲染器，不需要显示器
+static void bench_texture_upload() {
+    if (g_filter && !strstr("texture_upload", g_filter))
+        return;
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+        std::cerr << "跳过纹理上传基准，无法初始化SDL - " << SDL_GetError() << "\n";
+        return;
+    }
+    SDL_Window *window = SDL_CreateWindow("bench", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+                                          640, 360, SDL_WINDOW_HIDDEN);
+    SDL_Renderer *renderer = window ? SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE) : nullptr;
+    if (!renderer) {
+        std::cerr << "跳过纹理上传基准，无法创建渲染器 - " << SDL_GetError() << "\n";
+        if (window)
+            SDL_DestroyWindow(window);
+        SDL_Quit();
+        return;
+    }
+
+    for (const Resolution &res : resolutions) {
+        const int w = res.width, h = res.height;
+        SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_IYUV,
+                                                 SDL_TEXTUREACCESS_STREAMING, w, h);
+        if (!texture)
+            continue;
+        const size_t frame_bytes = (size_t)w * h * 3 / 2;
+        std::vector<uint8_t> frame(frame_bytes);
+        fill_random(frame.data(), frame.size(), 11);
+        const Uint8 *y = frame.data();
+        const Uint8 *u = y + (size_t)w * h;
+        const Uint8 *v = u + (size_t)w * h / 4;
+        std::string params = std::to_string(w) + "x" + std::to_string(h);
+
+        run_bench("texture_upload", "update", params, frame_bytes, [&]() {
+            SDL_UpdateTexture(texture, nullptr, frame.data(), w);
+        });
+        run_bench("texture_upload", "update-yuv", params, frame_bytes, [&]() {
+            SDL_UpdateYUVTexture(texture, nullptr, y, w, u, w / 2, v, w / 2);
+        });
+        SDL_DestroyTexture(texture);
+    }
+
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+}
+
+// 把当前线程绑定到指定CPU，减少迁移带来的抖动
+static void pin_cpu(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0)
+        std::cerr << "警告: 无法绑定到 CPU " << cpu << "\n";
+#else
+    (void)cpu;
+    std::cerr << "警告: 当前平台不支持绑定CPU\n";
+#endif
+}
+
+int main(int argc, char *argv[]) {
+    int cpu = 0;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--cpu" && i + 1 < argc) {
+            cpu = atoi(argv[++i]);
+        } else if (arg == "--reps" && i + 1 < argc) {
+            g_reps = atoi(argv[++i]);
+        } else if (arg == "--filter" && i + 1 < argc) {
+            g_filter = argv[++i];
+        } else {
+            std::cerr << "用法: " << argv[0] << " [--cpu 编号] [--reps 重复次数] [--filter 内核名]\n";
+            return -1;
+        }
+    }
+    if (g_reps < 2)
+        g_reps = 2;
+
+    pin_cpu(cpu);
+    FILE *devnull = fopen("/dev/null", "wb");
+    if (!devnull) {
+        std::cerr << "无法打开 /dev/null\n";
+        return -1;
+    }
+
+    printf("%-16s %-14s %-12s %14s %8s %9s\n", "kernel", "variant", "params", "ns/op", "stddev", "GB/s");
+    bench_save_frame(devnull);
+    bench_interleave(devnull);
+    bench_adts();
+    bench_compare();
+    bench_peaks();
+    bench_mix();
+    bench_frame_hash();
+    bench_texture_upload();
+
+    fclose(devnull);
+    return 0;
+}
@@ -0,0 +1,100 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+/*
+ * 长时间解码任务的断点文件（<输出文件>.ckpt），文本格式，每行一个字段：
+ *   input_pos     恢复时输入要回到的位置（save_yuv 为关键帧 PTS，save_pcm 为预滚包的字节偏移）
+ *   output_bytes  该位置之前已经完整写入输出文件的字节数，恢复时把输出截断到这里
+ *   units         output_bytes 对应的帧数（视频）或采样数（音频）
+ *   input_size    输入文件大小，用来确认恢复时还是同一个输入
+ *   param0..2     工具自己的参数（视频为宽、高；音频为采样格式、声道数、采样率）
+ * 先写入 <路径>.tmp 再 rename 覆盖，进程在任何时刻退出都只会留下完整的断点。
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CHECKPOINT_VERSION 1
+
+typedef struct Checkpoint {
+    int64_t input_pos;
+    uint64_t output_bytes;
+    uint64_t units;
+    int64_t input_size;
+    int param[3];
+} Checkpoint;
+
+// 输入文件大小，无法获取（如管道）时返回 -1
+static int64_t checkpoint_input_size(const char *filename)
+{
+    struct stat st;
+    if (stat(filename, &st) != 0 || !S_ISREG(st.st_mode))
+        return -1;
+    return (int64_t)st.st_size;
+}
+
+// 原子地写入断点：调用前输出文件必须已经 fflush，保证 output_bytes 之前的数据都已交给内核
+static int checkpoint_write(const char *path, const Checkpoint *ckpt)
+{
+    char tmp[1024];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *f = fopen(tmp, "w");
+    if (!f)
+        return -1;
+    fprintf(f, "version %d\n", CHECKPOINT_VERSION);
+    fprintf(f, "input_pos %lld\n", (long long)ckpt->input_pos);
+    fprintf(f, "output_bytes %llu\n", (unsigned long long)ckpt->output_bytes);
+    fprintf(f, "units %llu\n", (unsigned long long)ckpt->units);
+    fprintf(f, "input_size %lld\n", (long long)ckpt->input_size);
+    fprintf(f, "params %d %d %d\n", ckpt->param[0], ckpt->param[1], ckpt->param[2]);
+    if (fclose(f) != 0 || rename(tmp, path) != 0)
+    {
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+// 读取断点，文件不存在或格式不对时返回 -1
+static int checkpoint_read(const char *path, Checkpoint *ckpt)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return -1;
+    int version = 0;
+    long long input_pos = 0, input_size = 0;
+    unsigned long long output_bytes = 0, units = 0;
+    int n = fscanf(f, "version %d\ninput_pos %lld\noutput_bytes %llu\nunits %llu\ninput_size %lld\nparams %d %d %d",
+                   &version, &input_pos, &output_bytes, &units, &input_size,
+                   &ckpt->param[0], &ckpt->param[1], &ckpt->param[2]);
+    fclose(f);
+    if (n != 8 || version != CHECKPOINT_VERSION)
+        return -1;
+    ckpt->input_pos = input_pos;
+    ckpt->output_bytes = output_bytes;
+    ckpt->units = units;
+    ckpt->input_size = input_size;
+    return 0;
+}
+
+// 以读写方式打开已有输出并截断到断点位置，之后从末尾继续写
+static FILE *checkpoint_reopen_output(const char *filename, uint64_t output_bytes)
+{
+    FILE *f = fopen(filename, "r+b");
+    if (!f)
+        return NULL;
+    struct stat st;
+    if (fstat(fileno(f), &st) != 0 || (uint64_t)st.st_size < output_bytes ||
+        ftruncate(fileno(f), (off_t)output_bytes) != 0 || fseeko(f, (off_t)output_bytes, SEEK_SET) != 0)
+    {
+        fclose(f);
+        return NULL;
+    }
+    return f;
+}
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,281 @@
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/avutil.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/mathematics.h>
+}
+
+#include <iostream>
+#include <string>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/*
+ * 合成测试素材生成器：用 libavcodec 内置编码器（MPEG-4 视频 + AAC 音频）生成可重复的测试输入，
+ * 分辨率（最大4K）、GOP 长度、时长、声道数和采样率都可配置，按输出扩展名封装为 mp4 或 flv。
+ * 编码器和封装器都使用 bitexact 模式，相同参数（包括线程数）生成的文件逐字节相同。
+ */
+
+static const int MAX_WIDTH = 3840;
+static const int MAX_HEIGHT = 2160;
+
+// 生成参数
+struct GenOptions {
+    int width = 640;
+    int height = 360;
+    int fps = 25;
+    int gop = 50;
+    double duration = 10.0;     // 秒
+    int video_kbps = 0;         // 0 表示按分辨率和帧率自动计算
+    int channels = 2;           // 0 表示不生成音频
+    int sample_rate = 48000;
+    int threads = 1;            // MPEG-4 的片级多线程会改变码流，线程数相同时输出才相同
+};
+
+// 一路输出流的编码状态
+struct OutputStream {
+    AVStream* stream = nullptr;
+    AVCodecContext* enc = nullptr;
+    AVFrame* frame = nullptr;
+    AVPacket* pkt = nullptr;
+    int64_t next_pts = 0;       // 下一帧的时间戳，单位为编码器时间基
+    bool done = false;
+};
+
+// 填充一帧测试画面：随帧号移动的亮度渐变、移动的方块和缓慢变化的色度
+static void fill_video_frame(AVFrame* frame, int64_t index) {
+    const int w = frame->width, h = frame->height;
+    for (int y = 0; y < h; y++) {
+        uint8_t* row = frame->data[0] + y * frame->linesize[0];
+        for (int x = 0; x < w; x++)
+            row[x] = (uint8_t)(x + y + index * 3);
+    }
+    // 随帧号移动的白色方块，便于肉眼检查播放是否连续
+    const int box = h / 8;
+    const int bx = (int)((index * 7) % (w - box));
+    const int by = (int)((index * 5) % (h - box));
+    for (int y = by; y < by + box; y++)
+        memset(frame->data[0] + y * frame->linesize[0] + bx, 235, box);
+    for (int y = 0; y < h / 2; y++) {
+        uint8_t* u = frame->data[1] + y * frame->linesize[1];
+        uint8_t* v = frame->data[2] + y * frame->linesize[2];
+        for (int x = 0; x < w / 2; x++) {
+            u[x] = (uint8_t)(128 + y + index * 2);
+            v[x] = (uint8_t)(64 + x + index * 5);
+        }
+    }
+}
+
+// 填充一帧测试音频：每个声道一个不同频率的正弦波（440Hz、660Hz、880Hz...）
+static void fill_audio_frame(AVFrame* frame, int64_t first_sample, int sample_rate) {
+    const int channels = frame->ch_layout.nb_channels;
+    for (int ch = 0; ch < channels; ch++) {
+        float* dst = reinterpret_cast<float*>(frame->data[ch]);
+        const double freq = 440.0 * (2 + ch) / 2;
+        for (int i = 0; i < frame->nb_samples; i++)
+            dst[i] = (float)(0.5 * sin(2 * M_PI * freq * (first_sample + i) / sample_rate));
+    }
+}
+
+// 编码一帧（frame 为空时冲刷编码器）并把输出的包写入封装器
+static int encode_and_write(AVFormatContext* oc, OutputStream& os, AVFrame* frame) {
+    int ret = avcodec_send_frame(os.enc, frame);
+    if (ret < 0)
+        return ret;
+    while ((ret = avcodec_receive_packet(os.enc, os.pkt)) == 0) {
+        av_packet_rescale_ts(os.pkt, os.enc->time_base, os.stream->time_base);
+        os.pkt->stream_index = os.stream->index;
+        if ((ret = av_interleaved_write_frame(oc, os.pkt)) < 0)
+            return ret;
+    }
+    return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF ? 0 : ret;
+}
+
+// 创建编码器和输出流：video 为真时为 MPEG-4 视频，否则为 AAC 音频
+static bool open_stream(AVFormatContext* oc, OutputStream& os, enum AVCodecID codec_id, const GenOptions& opts,
+                        bool video) {
+    const AVCodec* codec = avcodec_find_encoder(codec_id);
+    if (!codec) {
+        std::cerr << "未找到编码器: " << avcodec_get_name(codec_id) << "\n";
+        return false;
+    }
+    os.stream = avformat_new_stream(oc, nullptr);
+    os.enc = avcodec_alloc_context3(codec);
+    os.pkt = av_packet_alloc();
+    os.frame = av_frame_alloc();
+    if (!os.stream || !os.enc || !os.pkt || !os.frame)
+        return false;
+
+    AVCodecContext* c = os.enc;
+    if (video) {
+        c->width = opts.width;
+        c->height = opts.height;
+        c->pix_fmt = AV_PIX_FMT_YUV420P;
+        c->time_base = AVRational{1, opts.fps};
+        c->framerate = AVRational{opts.fps, 1};
+        c->gop_size = opts.gop;
+        c->max_b_frames = 0;
+        c->bit_rate = opts.video_kbps > 0 ? (int64_t)opts.video_kbps * 1000
+                                          : (int64_t)opts.width * opts.height * opts.fps / 10;
+        c->thread_count = opts.threads;
+        c->thread_type = FF_THREAD_SLICE;
+    } else {
+        c->sample_fmt = AV_SAMPLE_FMT_FLTP;
+        c->sample_rate = opts.sample_rate;
+        av_channel_layout_default(&c->ch_layout, opts.channels);
+        c->bit_rate = 64000 * opts.channels;
+        c->time_base = AVRational{1, opts.sample_rate};
+    }
+    c->flags |= AV_CODEC_FLAG_BITEXACT;
+    if (oc->oformat->flags & AVFMT_GLOBALHEADER)
+        c->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    if (avcodec_open2(c, codec, nullptr) < 0) {
+        std::cerr << "无法打开编码器: " << codec->name << "\n";
+        return false;
+    }
+    avcodec_parameters_from_context(os.stream->codecpar, c);
+    os.stream->time_base = c->time_base;
+
+    // 编码用的帧缓冲区
+    if (video) {
+        os.frame->format = c->pix_fmt;
+        os.frame->width = c->width;
+        os.frame->height = c->height;
+    } else {
+        os.frame->format = c->sample_fmt;
+        os.frame->sample_rate = c->sample_rate;
+        os.frame->nb_samples = c->frame_size;
+        av_channel_layout_copy(&os.frame->ch_layout, &c->ch_layout);
+    }
+    return av_frame_get_buffer(os.frame, 0) == 0;
+}
+
+static void close_stream(OutputStream& os) {
+    avcodec_free_context(&os.enc);
+    av_frame_free(&os.frame);
+    av_packet_free(&os.pkt);
+}
+
+// 生成下一帧并编码，超过时长后冲刷编码器并标记结束
+static int write_next(AVFormatContext* oc, OutputStream& os, bool video, const GenOptions& opts) {
+    if (av_compare_ts(os.next_pts, os.enc->time_base, (int64_t)(opts.duration * 1000), AVRational{1, 1000}) >= 0) {
+        os.done = true;
+        return encode_and_write(oc, os, nullptr);
+    }
+    int ret = av_frame_make_writable(os.frame);
+    if (ret < 0)
+        return ret;
+    if (video) {
+        fill_video_frame(os.frame, os.next_pts);
+        os.frame->pts = os.next_pts++;
+    } else {
+        fill_audio_frame(os.frame, os.next_pts, opts.sample_rate);
+        os.frame->pts = os.next_pts;
+        os.next_pts += os.frame->nb_samples;
+    }
+    return encode_and_write(oc, os, os.frame);
+}
+
+static int generate(const char* output_filename, const GenOptions& opts) {
+    AVFormatContext* oc = nullptr;
+    avformat_alloc_output_context2(&oc, nullptr, nullptr, output_filename);
+    if (!oc) {
+        std::cerr << "无法根据扩展名确定输出格式（支持 .mp4 / .flv）\n";
+        return -1;
+    }
+    oc->flags |= AVFMT_FLAG_BITEXACT;
+
+    OutputStream video, audio;
+    bool ok = open_stream(oc, video, AV_CODEC_ID_MPEG4, opts, true);
+    if (ok && opts.channels > 0)
+        ok = open_stream(oc, audio, AV_CODEC_ID_AAC, opts, false);
+    else
+        audio.done = true;
+
+    int ret = ok ? 0 : -1;
+    if (ret == 0 && !(oc->oformat->flags & AVFMT_NOFILE))
+        ret = avio_open(&oc->pb, output_filename, AVIO_FLAG_WRITE);
+    if (ret == 0)
+        ret = avformat_write_header(oc, nullptr);
+    if (ret < 0) {
+        std::cerr << "无法打开输出文件: " << output_filename << "\n";
+    } else {
+        // 每次写时间戳较小的一路，让封装器按时间顺序交错
+        while (ret >= 0 && (!video.done || !audio.done)) {
+            bool pick_video = !video.done && (audio.done || av_compare_ts(video.next_pts, video.enc->time_base,
+                                                                          audio.next_pts, audio.enc->time_base) <= 0);
+            ret = pick_video ? write_next(oc, video, true, opts) : write_next(oc, audio, false, opts);
+        }
+        if (ret < 0)
+            std::cerr << "编码或封装时出错\n";
+        av_write_trailer(oc);
+    }
+
+    if (oc->pb && !(oc->oformat->flags & AVFMT_NOFILE))
+        avio_closep(&oc->pb);
+    close_stream(video);
+    close_stream(audio);
+    avformat_free_context(oc);
+    return ret < 0 ? -1 : 0;
+}
+
+// 解析 WxH 格式的尺寸
+static bool parse_size(const char* arg, int& width, int& height) {
+    return sscanf(arg, "%dx%d", &width, &height) == 2;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "用法: " << argv[0] << " <输出文件.mp4|.flv> [--size WxH] [--fps N] [--gop N] [--duration 秒]"
+                  << " [--bitrate kbps] [--channels N] [--rate Hz] [--threads N]\n";
+        return -1;
+    }
+
+    const char* output_filename = argv[1];
+    GenOptions opts;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--size" && has_value) {
+            if (!parse_size(argv[++i], opts.width, opts.height)) {
+                std::cerr << "无效的尺寸: " << argv[i] << "\n";
+                return -1;
+            }
+        } else if (arg == "--fps" && has_value) {
+            opts.fps = atoi(argv[++i]);
+        } else if (arg == "--gop" && has_value) {
+            opts.gop = atoi(argv[++i]);
+        } else if (arg == "--duration" && has_value) {
+            opts.duration = atof(argv[++i]);
+        } else if (arg == "--bitrate" && has_value) {
+            opts.video_kbps = atoi(argv[++i]);
+        } else if (arg == "--channels" && has_value) {
+            opts.channels = atoi(argv[++i]);
+        } else if (arg == "--rate" && has_value) {
+            opts.sample_rate = atoi(argv[++i]);
+        } else if (arg == "--threads" && has_value) {
+            opts.threads = atoi(argv[++i]);
+        } else {
+            std::cerr << "未知选项: " << argv[i] << "\n";
+            return -1;
+        }
+    }
+
+    // MPEG-4 要求宽高为偶数；方块和色度图案要求至少16像素
+    if (opts.width < 16 || opts.height < 16 || opts.width > MAX_WIDTH || opts.height > MAX_HEIGHT ||
+        (opts.width | opts.height) & 1 || opts.fps <= 0 || opts.fps > 240 || opts.gop <= 0 || opts.duration <= 0 ||
+        opts.channels < 0 || opts.channels > 8 || opts.sample_rate < 8000 || opts.threads < 1) {
+        std::cerr << "无效的参数（最大 " << MAX_WIDTH << "x" << MAX_HEIGHT << "，宽高为偶数，声道数 0-8）\n";
+        return -1;
+    }
+
+    std::cout << "生成 " << output_filename << ": " << opts.width << "x" << opts.height << "@" << opts.fps
+              << " GOP " << opts.gop << ", " << opts.duration << " 秒";
+    if (opts.channels > 0)
+        std::cout << ", " << opts.channels << " 声道 " << opts.sample_rate << " Hz";
+    std::cout << "\n";
+    return generate(output_filename, opts);
+}
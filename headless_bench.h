@@ -0,0 +1,77 @@
+#ifndef HEADLESS_BENCH_H
+#define HEADLESS_BENCH_H
+
+/*
+ * SDL 播放器的无头基准模式（--bench N）：
+ *   - 视频使用 dummy 驱动（配合软件渲染器），不需要显示器
+ *   - 音频使用 disk 驱动写入 /dev/null，并把模拟的设备延迟设为0，回调不再按实时节奏调用
+ * 播放循环去掉 SDL_Delay，按阶段统计耗时。
+ */
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+
+// 切换到无头驱动，已经通过环境变量指定的驱动不覆盖
+static void bench_use_headless_drivers() {
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+    SDL_setenv("SDL_AUDIODRIVER", "disk", 0);
+    SDL_setenv("SDL_DISKAUDIOFILE", "/dev/null", 0);
+    SDL_setenv("SDL_DISKAUDIODELAY", "0", 0);
+}
+
+// 单个阶段的耗时统计，单位为 SDL 高精度计数器的刻度
+struct StageTimer {
+    const char* name;
+    Uint64 total;
+    Uint64 max;
+    Uint64 count;
+
+    explicit StageTimer(const char* n) : name(n), total(0), max(0), count(0) {}
+};
+
+// 记录从 start 到现在的一次耗时
+static inline void stage_record(StageTimer& timer, Uint64 start) {
+    Uint64 elapsed = SDL_GetPerformanceCounter() - start;
+    timer.total += elapsed;
+    if (elapsed > timer.max)
+        timer.max = elapsed;
+    timer.count++;
+}
+
+static void print_stage(const StageTimer& timer) {
+    const double ms = 1000.0 / SDL_GetPerformanceFrequency();
+    printf("  %-12s 平均 %8.3f ms  最大 %8.3f ms  (%llu 次)\n", timer.name,
+           timer.count ? timer.total * ms / timer.count : 0.0, timer.max * ms,
+           (unsigned long long)timer.count);
+}
+
+// 输出视频基准结果：总帧数、最大可持续帧率和各阶段耗时
+static void print_video_bench(int frames, Uint64 start, const StageTimer* stages, int num_stages) {
+    double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+    printf("视频基准 [%s]: %d 帧, %.3f 秒, %.1f fps\n", SDL_GetCurrentVideoDriver(), frames, seconds,
+           seconds > 0 ? frames / seconds : 0.0);
+    for (int i = 0; i < num_stages; i++)
+        print_stage(stages[i]);
+}
+
+// 音频回调的统计
+struct AudioBenchStats {
+    Uint64 callbacks;
+    Uint64 bytes;
+    Uint64 start;
+    StageTimer callback;
+
+    AudioBenchStats() : callbacks(0), bytes(0), start(0), callback("callback") {}
+};
+
+// 输出音频基准结果：回调吞吐量以及相对实时播放的倍数
+static void print_audio_bench(const AudioBenchStats& stats, int bytes_per_second) {
+    double seconds = (double)(SDL_GetPerformanceCounter() - stats.start) / SDL_GetPerformanceFrequency();
+    double rate = seconds > 0 ? stats.bytes / seconds : 0.0;
+    printf("音频基准 [%s]: %llu 次回调, %.2f MB, %.3f 秒, %.2f MB/s (实时的 %.1f 倍)\n",
+           SDL_GetCurrentAudioDriver(), (unsigned long long)stats.callbacks, stats.bytes / 1e6, seconds,
+           rate / 1e6, rate / bytes_per_second);
+    print_stage(stats.callback);
+}
+
+#endif // HEADLESS_BENCH_H
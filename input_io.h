@@ -0,0 +1,322 @@
+#ifndef INPUT_IO_H
+#define INPUT_IO_H
+
+/*
+ * 解复用工具共用的输入层：
+ *   - 默认直接使用 FFmpeg 的 file 协议打开已完成的文件
+ *   - --follow 时使用自定义 AVIOContext 跟随仍在写入的文件，读到末尾后等待新数据
+ *   - 输入为 "-" 或 FIFO/管道时同样走自定义 AVIOContext，从 fd 顺序读取
+ *   - --mmap 时把已完成的文件映射到内存，读回调直接从映射区拷贝，并按窗口预读
+ * 超过 timeout 毫秒没有新数据即视为输入结束。
+ */
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavutil/mem.h>
+}
+
+#include <string>
+#include <climits>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// 输入相关的命令行选项
+struct InputOptions {
+    bool follow = false;            // 跟随仍在写入的文件
+    int timeout_ms = 5000;          // 超过该时长没有新数据视为结束
+    int readahead = 256 * 1024;     // 自定义 AVIOContext 的缓冲区大小（预读量）
+    bool use_mmap = false;          // 把已完成的文件映射到内存读取
+};
+
+// 只读映射的输入文件
+struct MappedInput {
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    size_t window = 4 * 1024 * 1024; // 每次提示内核预读的字节数
+    size_t next_advise = 0;          // 读到该位置时发出下一次预读提示
+};
+
+// 自定义 AVIOContext 的状态
+struct InputSource {
+    int fd = -1;
+    bool regular = false;           // 普通文件可以 seek，管道/FIFO 只能顺序读
+    int64_t pos = 0;
+    InputOptions opts;
+    MappedInput map;                // 使用 --mmap 时的映射区
+};
+
+// 文件末尾轮询新数据的间隔
+static const int INPUT_POLL_INTERVAL_MS = 20;
+
+// 解析输入相关的选项，识别成功时返回 true 并移动下标
+static bool parse_input_option(int argc, char *argv[], int &i, InputOptions &opts) {
+    std::string arg = argv[i];
+    if (arg == "--follow") {
+        opts.follow = true;
+    } else if (arg == "--timeout" && i + 1 < argc) {
+        opts.timeout_ms = atoi(argv[++i]);
+    } else if (arg == "--readahead" && i + 1 < argc) {
+        // 必须是正整数，且换算成字节后不超过 int 范围；无效时不移动下标，由调用方报错
+        char *end = nullptr;
+        errno = 0;
+        long kb = strtol(argv[i + 1], &end, 10);
+        if (end == argv[i + 1] || *end != '\0' || errno != 0 || kb <= 0 || kb > INT_MAX / 1024) {
+            std::cerr << "无效的预读量: " << argv[i + 1] << " KB\n";
+            return false;
+        }
+        opts.readahead = (int)kb * 1024;
+        i++;
+    } else if (arg == "--mmap") {
+        opts.use_mmap = true;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// 打印输入相关选项的用法
+static const char *input_options_usage() {
+    return "[--follow] [--timeout 毫秒] [--readahead KB] [--mmap]";
+}
+
+// 映射整个输入文件，失败（空文件、管道等）时返回 -1
+static int map_input(const char *filename, MappedInput &map) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        close(fd);
+        return -1;
+    }
+    void *ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED)
+        return -1;
+    madvise(ptr, st.st_size, MADV_SEQUENTIAL);
+    map.data = static_cast<const uint8_t *>(ptr);
+    map.size = st.st_size;
+    map.next_advise = 0;
+    return 0;
+}
+
+static void unmap_input(MappedInput &map) {
+    if (map.data)
+        munmap(const_cast<uint8_t *>(map.data), map.size);
+    map.data = nullptr;
+    map.size = 0;
+}
+
+// 读到 next_advise 时提示内核预读下一个窗口，避免在缺页时同步等待磁盘
+static void advise_input_window(MappedInput &map, size_t pos) {
+    if (pos < map.next_advise || pos >= map.size)
+        return;
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t start = pos & ~(page - 1);
+    size_t len = map.window;
+    if (start + len > map.size)
+        len = map.size - start;
+    madvise(const_cast<uint8_t *>(map.data) + start, len, MADV_WILLNEED);
+    map.next_advise = pos + map.window / 2;
+}
+
+// 读回调：有数据立即返回，到达末尾时等待写入方，超时后返回 EOF
+static int input_read_packet(void *opaque, uint8_t *buf, int buf_size) {
+    InputSource *src = static_cast<InputSource *>(opaque);
+    int waited = 0;
+    while (true) {
+        // 管道/FIFO 的 read 会一直阻塞，先等待可读，超时视为结束
+        if (!src->regular) {
+            struct pollfd pfd;
+            pfd.fd = src->fd;
+            pfd.events = POLLIN;
+            int ret = poll(&pfd, 1, src->opts.timeout_ms);
+            if (ret == 0)
+                return AVERROR_EOF;
+            if (ret < 0) {
+                if (errno == EINTR)
+                    continue;
+                return AVERROR(errno);
+            }
+        }
+
+        ssize_t n = read(src->fd, buf, buf_size);
+        if (n > 0) {
+            src->pos += n;
+#ifdef POSIX_FADV_WILLNEED
+            if (src->regular)
+                posix_fadvise(src->fd, src->pos, src->opts.readahead, POSIX_FADV_WILLNEED);
+#endif
+            return (int)n;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return AVERROR(errno);
+
+        // read 返回0：管道说明写入方已关闭；普通文件则可能还在追加，轮询直到超时
+        if (!src->regular || !src->opts.follow || waited >= src->opts.timeout_ms)
+            return AVERROR_EOF;
+        usleep(INPUT_POLL_INTERVAL_MS * 1000);
+        waited += INPUT_POLL_INTERVAL_MS;
+    }
+}
+
+// seek 回调：只有普通文件支持；跟随模式下文件还在增长，不报告总大小
+static int64_t input_seek(void *opaque, int64_t offset, int whence) {
+    InputSource *src = static_cast<InputSource *>(opaque);
+    if (!src->regular)
+        return -1;
+    if (whence == AVSEEK_SIZE) {
+        if (src->opts.follow)
+            return -1;
+        struct stat st;
+        return fstat(src->fd, &st) == 0 ? (int64_t)st.st_size : -1;
+    }
+    off_t pos = lseek(src->fd, offset, whence & ~AVSEEK_FORCE);
+    if (pos < 0)
+        return AVERROR(errno);
+    src->pos = pos;
+    return pos;
+}
+
+// 映射区的读回调：直接从映射区拷贝，不再有 read 系统调用
+static int input_map_read_packet(void *opaque, uint8_t *buf, int buf_size) {
+    InputSource *src = static_cast<InputSource *>(opaque);
+    MappedInput &map = src->map;
+    if ((size_t)src->pos >= map.size)
+        return AVERROR_EOF;
+    size_t n = map.size - src->pos;
+    if (n > (size_t)buf_size)
+        n = buf_size;
+    advise_input_window(map, src->pos);
+    memcpy(buf, map.data + src->pos, n);
+    src->pos += n;
+    return (int)n;
+}
+
+static int64_t input_map_seek(void *opaque, int64_t offset, int whence) {
+    InputSource *src = static_cast<InputSource *>(opaque);
+    int64_t size = (int64_t)src->map.size;
+    switch (whence & ~AVSEEK_FORCE) {
+    case AVSEEK_SIZE: return size;
+    case SEEK_SET: break;
+    case SEEK_CUR: offset += src->pos; break;
+    case SEEK_END: offset += size; break;
+    default: return -1;
+    }
+    if (offset < 0 || offset > size)
+        return AVERROR(EINVAL);
+    src->pos = offset;
+    return offset;
+}
+
+// 为输入源创建自定义 AVIOContext 并打开输入，失败时释放 src
+static int open_input_source(AVFormatContext **ctx, InputSource *src, const char *filename) {
+    const InputOptions &opts = src->opts;
+    bool mapped = src->map.data != nullptr;
+    unsigned char *buffer = static_cast<unsigned char *>(av_malloc(opts.readahead));
+    AVIOContext *pb = buffer ? avio_alloc_context(buffer, opts.readahead, 0, src,
+                                                  mapped ? input_map_read_packet : input_read_packet,
+                                                  nullptr, mapped ? input_map_seek : input_seek) : nullptr;
+    if (!pb) {
+        av_free(buffer);
+        unmap_input(src->map);
+        delete src;
+        return AVERROR(ENOMEM);
+    }
+    pb->seekable = src->regular ? 1 : 0;
+
+    *ctx = avformat_alloc_context();
+    if (!*ctx) {
+        av_freep(&pb->buffer);
+        avio_context_free(&pb);
+        unmap_input(src->map);
+        delete src;
+        return AVERROR(ENOMEM);
+    }
+    (*ctx)->pb = pb;
+    (*ctx)->flags |= AVFMT_FLAG_CUSTOM_IO;
+    int ret = avformat_open_input(ctx, filename, nullptr, nullptr);
+    if (ret < 0) {
+        // 打开失败时 FFmpeg 已经释放了 ctx，自定义 IO 需要自己释放
+        av_freep(&pb->buffer);
+        avio_context_free(&pb);
+        unmap_input(src->map);
+        delete src;
+    }
+    return ret;
+}
+
+// 为 fd 创建自定义 AVIOContext 并打开输入
+static int open_input_fd(AVFormatContext **ctx, int fd, const char *filename, const InputOptions &opts) {
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        return AVERROR(errno);
+
+    InputSource *src = new InputSource;
+    src->fd = fd;
+    src->regular = S_ISREG(st.st_mode);
+    src->opts = opts;
+    return open_input_source(ctx, src, filename);
+}
+
+// 打开输入：普通文件走默认协议（--mmap 时走映射区），跟随模式、标准输入和管道走自定义 AVIOContext
+static int open_input_file(AVFormatContext **ctx, const char *filename, const InputOptions &opts) {
+    bool is_stdin = strcmp(filename, "-") == 0;
+    struct stat st;
+    bool regular = !is_stdin && stat(filename, &st) == 0 && S_ISREG(st.st_mode);
+    if (regular && !opts.follow && opts.use_mmap) {
+        InputSource *src = new InputSource;
+        src->regular = true;
+        src->opts = opts;
+        src->map.window = opts.readahead * 16;
+        if (map_input(filename, src->map) == 0)
+            return open_input_source(ctx, src, filename);
+        delete src;
+    }
+    if (regular && !opts.follow)
+        return avformat_open_input(ctx, filename, nullptr, nullptr);
+
+    int fd = is_stdin ? dup(STDIN_FILENO) : open(filename, O_RDONLY);
+    if (fd < 0)
+        return AVERROR(errno);
+    int ret = open_input_fd(ctx, fd, is_stdin ? "pipe:" : filename, opts);
+    if (ret < 0)
+        close(fd);
+    return ret;
+}
+
+// 关闭输入，同时释放自定义 AVIOContext
+static void close_input_file(AVFormatContext **ctx) {
+    if (!*ctx)
+        return;
+    AVIOContext *pb = (*ctx)->pb;
+    bool custom = ((*ctx)->flags & AVFMT_FLAG_CUSTOM_IO) != 0;
+    avformat_close_input(ctx);
+    if (custom && pb) {
+        InputSource *src = static_cast<InputSource *>(pb->opaque);
+        av_freep(&pb->buffer);
+        avio_context_free(&pb);
+        unmap_input(src->map);
+        if (src->fd >= 0)
+            close(src->fd);
+        delete src;
+    }
+}
+
+// 输入是否需要边读边输出（跟随模式或非普通文件）
+static bool input_is_live(const char *filename, const InputOptions &opts) {
+    struct stat st;
+    return opts.follow || strcmp(filename, "-") == 0 || stat(filename, &st) != 0 || !S_ISREG(st.st_mode);
+}
+
+#endif // INPUT_IO_H
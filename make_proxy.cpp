@@ -0,0 +1,343 @@
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/avutil.h>
+#include <libavutil/opt.h>
+#include <libavutil/time.h>
+#include <libswscale/swscale.h>
+}
+
+#include <iostream>
+#include <string>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdlib>
+
+#include "input_io.h"
+
+/*
+ * 生成低分辨率代理文件：解码 -> 缩放 -> MPEG-4 编码 -> mp4 封装。
+ * 三个阶段分别在三个线程上流水执行，中间用有界队列传递 AVFrame：
+ *   解码线程   读包并解码（解码器使用帧级多线程）
+ *   缩放线程   libswscale 多线程缩放到代理尺寸
+ *   主线程     编码（帧级+片级多线程）并封装
+ */
+
+// 线程间传递帧的有界队列，满时阻塞生产者，close 之后消费者取完剩余帧即结束
+struct FrameQueue {
+    std::deque<AVFrame*> frames;
+    size_t capacity = 8;
+    bool closed = false;
+    std::mutex mutex;
+    std::condition_variable cond;
+};
+
+static void queue_push(FrameQueue& q, AVFrame* frame) {
+    std::unique_lock<std::mutex> lock(q.mutex);
+    q.cond.wait(lock, [&]() { return q.frames.size() < q.capacity; });
+    q.frames.push_back(frame);
+    q.cond.notify_all();
+}
+
+// 队列已关闭且为空时返回 nullptr
+static AVFrame* queue_pop(FrameQueue& q) {
+    std::unique_lock<std::mutex> lock(q.mutex);
+    q.cond.wait(lock, [&]() { return !q.frames.empty() || q.closed; });
+    if (q.frames.empty())
+        return nullptr;
+    AVFrame* frame = q.frames.front();
+    q.frames.pop_front();
+    q.cond.notify_all();
+    return frame;
+}
+
+static void queue_close(FrameQueue& q) {
+    std::lock_guard<std::mutex> lock(q.mutex);
+    q.closed = true;
+    q.cond.notify_all();
+}
+
+// 代理参数
+struct ProxyOptions {
+    int height = 360;           // 代理高度，宽度按原始宽高比计算
+    int bitrate_kbps = 1500;
+    int threads = 0;            // 0 表示使用全部CPU核心
+};
+
+// 解码线程：读取视频包并解码，把帧送入缩放队列
+static void decode_thread(AVFormatContext* fmt_ctx, AVCodecContext* dec_ctx, int stream_index, FrameQueue* out) {
+    AVPacket* pkt = av_packet_alloc();
+    AVFrame* frame = av_frame_alloc();
+    bool flushing = false;
+    while (!flushing) {
+        if (av_read_frame(fmt_ctx, pkt) < 0) {
+            // 输入结束，送入空包冲刷解码器
+            flushing = true;
+            avcodec_send_packet(dec_ctx, nullptr);
+        } else {
+            int ret = pkt->stream_index == stream_index ? avcodec_send_packet(dec_ctx, pkt) : -1;
+            av_packet_unref(pkt);
+            if (ret < 0)
+                continue; // 其它流的包或无法解码的包
+        }
+        while (avcodec_receive_frame(dec_ctx, frame) == 0) {
+            frame->pts = frame->best_effort_timestamp;
+            queue_push(*out, av_frame_clone(frame));
+            av_frame_unref(frame);
+        }
+    }
+    av_frame_free(&frame);
+    av_packet_free(&pkt);
+    queue_close(*out);
+}
+
+// 按当前源帧格式创建多线程缩放上下文
+static SwsContext* create_scaler(const AVFrame* src, int width, int height, int threads) {
+    SwsContext* sws = sws_alloc_context();
+    if (!sws)
+        return nullptr;
+    av_opt_set_int(sws, "srcw", src->width, 0);
+    av_opt_set_int(sws, "srch", src->height, 0);
+    av_opt_set_int(sws, "src_format", src->format, 0);
+    av_opt_set_int(sws, "dstw", width, 0);
+    av_opt_set_int(sws, "dsth", height, 0);
+    av_opt_set_int(sws, "dst_format", AV_PIX_FMT_YUV420P, 0);
+    av_opt_set_int(sws, "sws_flags", SWS_BILINEAR, 0);
+    av_opt_set_int(sws, "threads", threads, 0);
+    if (sws_init_context(sws, nullptr, nullptr) < 0) {
+        sws_freeContext(sws);
+        return nullptr;
+    }
+    return sws;
+}
+
+// 缩放线程：把解码帧缩放到代理尺寸，源尺寸或格式变化时重建缩放上下文
+static void scale_thread(FrameQueue* in, FrameQueue* out, int width, int height, int threads) {
+    SwsContext* sws = nullptr;
+    int src_w = 0, src_h = 0, src_fmt = AV_PIX_FMT_NONE;
+    while (AVFrame* src = queue_pop(*in)) {
+        if (!sws || src->width != src_w || src->height != src_h || src->format != src_fmt) {
+            sws_freeContext(sws);
+            sws = create_scaler(src, width, height, threads);
+            src_w = src->width;
+            src_h = src->height;
+            src_fmt = src->format;
+        }
+        AVFrame* dst = av_frame_alloc();
+        dst->width = width;
+        dst->height = height;
+        dst->format = AV_PIX_FMT_YUV420P;
+        if (!sws || av_frame_get_buffer(dst, 0) < 0 || sws_scale_frame(sws, dst, src) < 0) {
+            std::cerr << "缩放失败，跳过一帧\n";
+            av_frame_free(&dst);
+        } else {
+            dst->pts = src->pts;
+            queue_push(*out, dst);
+        }
+        av_frame_free(&src);
+    }
+    sws_freeContext(sws);
+    queue_close(*out);
+}
+
+// 把编码器输出的所有包写入封装器
+static int write_packets(AVCodecContext* enc_ctx, AVFormatContext* out_ctx, AVStream* out_stream, AVPacket* pkt) {
+    int ret;
+    while ((ret = avcodec_receive_packet(enc_ctx, pkt)) == 0) {
+        av_packet_rescale_ts(pkt, enc_ctx->time_base, out_stream->time_base);
+        pkt->stream_index = out_stream->index;
+        if (av_interleaved_write_frame(out_ctx, pkt) < 0) {
+            std::cerr << "复用数据包时出错\n";
+            return -1;
+        }
+    }
+    return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF ? 0 : ret;
+}
+
+// 生成代理文件，成功时返回0
+static int make_proxy(const char* input_filename, const char* output_filename, const InputOptions& input_opts,
+                      const ProxyOptions& opts) {
+    AVFormatContext* in_ctx = nullptr;
+    if (open_input_file(&in_ctx, input_filename, input_opts) < 0) {
+        std::cerr << "无法打开输入文件\n";
+        return -1;
+    }
+    if (avformat_find_stream_info(in_ctx, nullptr) < 0) {
+        std::cerr << "获取输入流信息失败\n";
+        close_input_file(&in_ctx);
+        return -1;
+    }
+
+    // 查找视频流并打开解码器（帧级多线程）
+    const AVCodec* decoder = nullptr;
+    int stream_index = av_find_best_stream(in_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, &decoder, 0);
+    if (stream_index < 0) {
+        std::cerr << "输入文件中未找到视频流\n";
+        close_input_file(&in_ctx);
+        return -1;
+    }
+    AVStream* in_stream = in_ctx->streams[stream_index];
+    AVCodecContext* dec_ctx = avcodec_alloc_context3(decoder);
+    if (!dec_ctx || avcodec_parameters_to_context(dec_ctx, in_stream->codecpar) < 0) {
+        std::cerr << "无法复制编解码器上下文\n";
+        avcodec_free_context(&dec_ctx);
+        close_input_file(&in_ctx);
+        return -1;
+    }
+    dec_ctx->pkt_timebase = in_stream->time_base;
+    dec_ctx->thread_count = opts.threads;
+    dec_ctx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+    if (avcodec_open2(dec_ctx, decoder, nullptr) < 0) {
+        std::cerr << "无法打开解码器\n";
+        avcodec_free_context(&dec_ctx);
+        close_input_file(&in_ctx);
+        return -1;
+    }
+
+    // 代理尺寸：固定高度，宽度按宽高比计算，都取偶数
+    int height = opts.height < dec_ctx->height ? opts.height : dec_ctx->height;
+    height &= ~1;
+    int width = (int)((int64_t)dec_ctx->width * height / dec_ctx->height) & ~1;
+
+    // MPEG-4 编码器，时间基取输入帧率（MPEG-4 要求时间基分母不超过16位）
+    AVRational frame_rate = av_guess_frame_rate(in_ctx, in_stream, nullptr);
+    if (frame_rate.num <= 0 || frame_rate.den <= 0 || frame_rate.num > 65535)
+        frame_rate = AVRational{25, 1};
+    const AVCodec* encoder = avcodec_find_encoder(AV_CODEC_ID_MPEG4);
+    AVCodecContext* enc_ctx = encoder ? avcodec_alloc_context3(encoder) : nullptr;
+    if (!enc_ctx) {
+        std::cerr << "未找到 MPEG-4 编码器\n";
+        avcodec_free_context(&dec_ctx);
+        close_input_file(&in_ctx);
+        return -1;
+    }
+    enc_ctx->width = width;
+    enc_ctx->height = height;
+    enc_ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+    enc_ctx->time_base = av_inv_q(frame_rate);
+    enc_ctx->framerate = frame_rate;
+    enc_ctx->bit_rate = (int64_t)opts.bitrate_kbps * 1000;
+    enc_ctx->gop_size = (frame_rate.num + frame_rate.den - 1) / frame_rate.den; // 约1秒一个关键帧，方便剪辑时定位
+    enc_ctx->max_b_frames = 0;
+    enc_ctx->thread_count = opts.threads;
+    enc_ctx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
+    // 输出封装，与 mp4_to_h264 的 save_video_stream 相同的流程
+    AVFormatContext* out_ctx = nullptr;
+    avformat_alloc_output_context2(&out_ctx, nullptr, nullptr, output_filename);
+    if (!out_ctx) {
+        std::cerr << "无法创建输出上下文\n";
+        avcodec_free_context(&enc_ctx);
+        avcodec_free_context(&dec_ctx);
+        close_input_file(&in_ctx);
+        return -1;
+    }
+    if (out_ctx->oformat->flags & AVFMT_GLOBALHEADER)
+        enc_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    AVStream* out_stream = avformat_new_stream(out_ctx, nullptr);
+    int ret = out_stream ? avcodec_open2(enc_ctx, encoder, nullptr) : -1;
+    if (ret >= 0)
+        ret = avcodec_parameters_from_context(out_stream->codecpar, enc_ctx);
+    if (ret >= 0) {
+        out_stream->time_base = enc_ctx->time_base;
+        if (!(out_ctx->oformat->flags & AVFMT_NOFILE))
+            ret = avio_open(&out_ctx->pb, output_filename, AVIO_FLAG_WRITE);
+    }
+    if (ret >= 0)
+        ret = avformat_write_header(out_ctx, nullptr);
+    if (ret < 0) {
+        std::cerr << "无法打开编码器或输出文件\n";
+        if (out_ctx->pb && !(out_ctx->oformat->flags & AVFMT_NOFILE))
+            avio_closep(&out_ctx->pb);
+        avformat_free_context(out_ctx);
+        avcodec_free_context(&enc_ctx);
+        avcodec_free_context(&dec_ctx);
+        close_input_file(&in_ctx);
+        return -1;
+    }
+
+    std::cout << "代理: " << dec_ctx->width << "x" << dec_ctx->height << " -> " << width << "x" << height
+              << ", " << opts.bitrate_kbps << " kbps, 线程: "
+              << (opts.threads ? std::to_string(opts.threads) : std::string("auto")) << "\n";
+
+    // 启动流水线：解码线程 -> 缩放线程 -> 主线程编码封装
+    FrameQueue decoded, scaled;
+    const int64_t start = av_gettime_relative();
+    std::thread decoder_worker(decode_thread, in_ctx, dec_ctx, stream_index, &decoded);
+    std::thread scaler_worker(scale_thread, &decoded, &scaled, width, height, opts.threads);
+
+    AVPacket* pkt = av_packet_alloc();
+    int64_t frames = 0;
+    int64_t last_pts = AV_NOPTS_VALUE;
+    bool failed = false;
+    while (AVFrame* frame = queue_pop(scaled)) {
+        // 输入时间戳换算到编码器时间基，保证严格递增
+        int64_t pts = frame->pts == AV_NOPTS_VALUE ? frames
+                                                    : av_rescale_q(frame->pts, in_stream->time_base, enc_ctx->time_base);
+        if (last_pts != AV_NOPTS_VALUE && pts <= last_pts)
+            pts = last_pts + 1;
+        last_pts = pts;
+        frame->pts = pts;
+        frame->pict_type = AV_PICTURE_TYPE_NONE;
+        if (!failed && (avcodec_send_frame(enc_ctx, frame) < 0 || write_packets(enc_ctx, out_ctx, out_stream, pkt) < 0))
+            failed = true; // 出错后继续取空队列，让前面的线程正常结束
+        av_frame_free(&frame);
+        frames++;
+    }
+    decoder_worker.join();
+    scaler_worker.join();
+
+    // 冲刷编码器并写入文件尾
+    if (!failed) {
+        avcodec_send_frame(enc_ctx, nullptr);
+        failed = write_packets(enc_ctx, out_ctx, out_stream, pkt) < 0;
+    }
+    av_write_trailer(out_ctx);
+    const double seconds = (av_gettime_relative() - start) / 1e6;
+    std::cout << "完成: " << frames << " 帧, " << seconds << " 秒, " << (seconds > 0 ? frames / seconds : 0.0)
+              << " fps\n";
+
+    av_packet_free(&pkt);
+    if (!(out_ctx->oformat->flags & AVFMT_NOFILE))
+        avio_closep(&out_ctx->pb);
+    avformat_free_context(out_ctx);
+    avcodec_free_context(&enc_ctx);
+    avcodec_free_context(&dec_ctx);
+    close_input_file(&in_ctx);
+    return failed ? -1 : 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "用法: " << argv[0] << " <输入文件|-> <输出文件.mp4> [--height 像素] [--bitrate kbps] [--threads N] "
+                  << input_options_usage() << "\n";
+        return -1;
+    }
+
+    const char* input_filename = argv[1];
+    const char* output_filename = argv[2];
+
+    InputOptions input_opts;
+    ProxyOptions opts;
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--height" && i + 1 < argc) {
+            opts.height = atoi(argv[++i]);
+        } else if (arg == "--bitrate" && i + 1 < argc) {
+            opts.bitrate_kbps = atoi(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            opts.threads = atoi(argv[++i]);
+        } else if (!parse_input_option(argc, argv, i, input_opts)) {
+            std::cerr << "未知选项: " << argv[i] << "\n";
+            return -1;
+        }
+    }
+    if (opts.height < 2 || opts.bitrate_kbps <= 0 || opts.threads < 0) {
+        std::cerr << "无效的代理参数\n";
+        return -1;
+    }
+
+    return make_proxy(input_filename, output_filename, input_opts, opts) == 0 ? 0 : -1;
+}
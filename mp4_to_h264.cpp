@@ -6,9 +6,13 @@ extern "C" {
 }
 
 #include <iostream>
+#include <cstring>
 
-// 保存视频流到输出文件的函数
-void save_video_stream(const char* output_filename, AVFormatContext* input_format_context, AVStream* input_stream) {
+#include "input_io.h"
+#include "output_cache.h"
+
+// 保存视频流到输出文件的函数，完整写出时返回 true
+bool save_video_stream(const char* output_filename, AVFormatContext* input_format_context, AVStream* input_stream, bool live) {
     AVFormatContext* output_format_context = nullptr;
     AVStream* output_stream = nullptr;
     AVPacket packet;
@@ -17,14 +21,14 @@ void save_video_stream(const char* output_filename, AVFormatContext* input_forma
     avformat_alloc_output_context2(&output_format_context, nullptr, nullptr, output_filename);
     if (!output_format_context) {
         std::cerr << "无法创建输出上下文\n";
-        return;
+        return false;
     }
 
     // 创建输出流
     output_stream = avformat_new_stream(output_format_context, nullptr);
     if (!output_stream) {
         std::cerr << "无法分配输出流\n";
-        return;
+        return false;
     }
 
     // 复制输入流的编解码参数到输出流
@@ -35,17 +39,23 @@ void save_video_stream(const char* output_filename, AVFormatContext* input_forma
     if (!(output_format_context->oformat->flags & AVFMT_NOFILE)) {
         if (avio_open(&output_format_context->pb, output_filename, AVIO_FLAG_WRITE) < 0) {
             std::cerr << "无法打开输出文件\n";
-            return;
+            return false;
         }
     }
 
+    // 输入仍在写入时每个包都刷新到输出文件
+    if (live) {
+        output_format_context->flags |= AVFMT_FLAG_FLUSH_PACKETS;
+    }
+
     // 写入文件头
     if (avformat_write_header(output_format_context, nullptr) < 0) {
         std::cerr << "打开输出文件时发生错误\n";
-        return;
+        return false;
     }
 
     // 从输入文件读取帧并写入输出文件
+    bool ok = true;
     while (av_read_frame(input_format_context, &packet) >= 0) {
         if (packet.stream_index == input_stream->index) {
             // 重新调整时间戳
@@ -58,6 +68,7 @@ void save_video_stream(const char* output_filename, AVFormatContext* input_forma
             // 写入数据包
             if (av_interleaved_write_frame(output_format_context, &packet) < 0) {
                 std::cerr << "复用数据包时出错\n";
+                ok = false;
                 break;
             }
         }
@@ -74,22 +85,43 @@ void save_video_stream(const char* output_filename, AVFormatContext* input_forma
 
     // 释放输出格式上下文
     avformat_free_context(output_format_context);
+    return ok;
 }
 
 int main(int argc, char* argv[]) {
     if (argc < 3) {
-        std::cerr << "Usage: " << argv[0] << " <输入文件> <输出视频文件>\n";
+        std::cerr << "Usage: " << argv[0] << " <输入文件|-> <输出视频文件> " << input_options_usage() << "\n";
         return -1;
     }
 
     const char* input_filename = argv[1];
     const char* output_video_filename = argv[2];
 
+    InputOptions input_opts;
+    for (int i = 3; i < argc; ++i) {
+        if (!parse_input_option(argc, argv, i, input_opts)) {
+            std::cerr << "未知选项: " << argv[i] << "\n";
+            return -1;
+        }
+    }
+
+    // 同一输入已经解复用过时直接从缓存复制；输出容器由扩展名决定，扩展名也是键的一部分
+    const bool live = input_is_live(input_filename, input_opts);
+    const char* ext = strrchr(output_video_filename, '.');
+    OutputCache cache;
+    const char* roles[] = {"video"};
+    const char* outputs[] = {output_video_filename};
+    if (!live && cache_open(cache, input_filename, std::string("mp4_to_h264|") + (ext ? ext : "")) &&
+        cache_fetch(cache, roles, outputs, 1)) {
+        std::cout << "从缓存复制输出: " << output_video_filename << "\n";
+        return 0;
+    }
+
     AVFormatContext* input_format_context = nullptr;
     AVStream* video_stream = nullptr;
 
     // 打开输入文件并读取文件头
-    if (avformat_open_input(&input_format_context, input_filename, nullptr, nullptr) < 0) {
+    if (open_input_file(&input_format_context, input_filename, input_opts) < 0) {
         std::cerr << "无法打开输入文件\n";
         return -1;
     }
@@ -114,10 +146,13 @@ int main(int argc, char* argv[]) {
     }
 
     // 保存视频流到输出文件
-    save_video_stream(output_video_filename, input_format_context, video_stream);
+    bool saved = save_video_stream(output_video_filename, input_format_context, video_stream, live);
 
     // 关闭输入文件
-    avformat_close_input(&input_format_context);
+    close_input_file(&input_format_context);
+
+    if (saved)
+        cache_store(cache, roles, outputs, 1);
 
     return 0;
 }
@@ -0,0 +1,285 @@
+#ifndef OUTPUT_CACHE_H
+#define OUTPUT_CACHE_H
+
+/*
+ * 解码/解复用输出的本地内容寻址缓存，设置环境变量 FFDEMO_CACHE=<目录> 后启用：
+ *   - 键 = 输入的抽样哈希（开头、结尾和中间均匀分布的若干块）+ 大小 + mtime + 工具名和参数
+ *   - 命中时优先用 reflink（FICLONE）克隆缓存文件，不支持时 mmap 缓存文件后整块写出；
+ *     不使用硬链接，因为工具会原地截断/改写输出（如 --resume），会把缓存一起改掉
+ *   - 每个条目可以有多个文件（如 save_pcm 的 PCM 和 .peaks），全部存在才算命中
+ *   - 按条目 mtime 做 LRU，总大小超过 FFDEMO_CACHE_SIZE_MB（默认2048）时淘汰最久未用的条目
+ *   - 命中/未命中次数记录在 <目录>/stats，每次运行结束时输出命中率
+ * 跟随模式、管道等不是普通文件的输入不走缓存。
+ */
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+
+// 抽样哈希读取的块数和块大小，小于 块数*块大小 的文件整体哈希
+static const int CACHE_SAMPLE_BLOCKS = 16;
+static const size_t CACHE_SAMPLE_SIZE = 64 * 1024;
+
+struct OutputCache {
+    bool enabled = false;
+    std::string dir;
+    std::string key;            // 32个十六进制字符
+    uint64_t budget = 0;        // 字节
+};
+
+// 128位键由两个独立的哈希拼成：FNV-1a，以及"加、乘、移位异或"的乘法哈希（结束时再做 murmur3 的 fmix64），
+// 两者的混合方式和常数都不同，一个碰撞时另一个不会跟着碰撞
+struct CacheHasher {
+    uint64_t a = 0xcbf29ce484222325ULL;
+    uint64_t b = 0x9e3779b97f4a7c15ULL;
+
+    void update(const void *data, size_t len) {
+        const uint8_t *p = static_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < len; i++) {
+            a = (a ^ p[i]) * 0x100000001b3ULL;
+            b = (b + p[i]) * 0xff51afd7ed558ccdULL;
+            b ^= b >> 29;
+        }
+    }
+
+    uint64_t digest_b() const {
+        uint64_t x = b;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return x;
+    }
+};
+
+// 计算输入的缓存键，参数不同（工具、输出格式、选项）得到不同的键
+static bool cache_open(OutputCache &cache, const char *input, const std::string &params) {
+    const char *dir = getenv("FFDEMO_CACHE");
+    if (!dir || !*dir)
+        return false;
+    int fd = open(input, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return false;
+    }
+
+    CacheHasher h;
+    int64_t meta[3] = {(int64_t)st.st_size, (int64_t)st.st_mtim.tv_sec, (int64_t)st.st_mtim.tv_nsec};
+    h.update(meta, sizeof(meta));
+    h.update(params.data(), params.size());
+
+    std::vector<uint8_t> buf(CACHE_SAMPLE_SIZE);
+    const uint64_t size = st.st_size;
+    const uint64_t sampled = (uint64_t)CACHE_SAMPLE_BLOCKS * CACHE_SAMPLE_SIZE;
+    const int blocks = size <= sampled ? (int)((size + CACHE_SAMPLE_SIZE - 1) / CACHE_SAMPLE_SIZE) : CACHE_SAMPLE_BLOCKS;
+    for (int i = 0; i < blocks; i++) {
+        // 小文件按顺序读完；大文件的块均匀分布，第一块在开头，最后一块在结尾
+        uint64_t offset = size <= sampled ? i * CACHE_SAMPLE_SIZE
+                                          : (size - CACHE_SAMPLE_SIZE) / (CACHE_SAMPLE_BLOCKS - 1) * i;
+        ssize_t n = pread(fd, buf.data(), CACHE_SAMPLE_SIZE, (off_t)offset);
+        if (n < 0) {
+            close(fd);
+            return false;
+        }
+        h.update(buf.data(), n);
+    }
+    close(fd);
+
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST)
+        return false;
+    char key[33];
+    snprintf(key, sizeof(key), "%016llx%016llx", (unsigned long long)h.a, (unsigned long long)h.digest_b());
+    const char *mb = getenv("FFDEMO_CACHE_SIZE_MB");
+    cache.budget = (uint64_t)(mb ? atoll(mb) : 2048) * 1024 * 1024;
+    cache.dir = dir;
+    cache.key = key;
+    cache.enabled = true;
+    return true;
+}
+
+static std::string cache_entry_path(const OutputCache &cache, const char *role) {
+    return cache.dir + "/" + cache.key + "." + role;
+}
+
+// 把 src 复制到新建的 dst：优先 reflink，只共享数据块；否则 mmap 后整块写出
+static bool cache_copy_file(const std::string &src, const std::string &dst) {
+    int in = open(src.c_str(), O_RDONLY);
+    if (in < 0)
+        return false;
+    struct stat st;
+    if (fstat(in, &st) != 0) {
+        close(in);
+        return false;
+    }
+    int out = open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0) {
+        close(in);
+        return false;
+    }
+
+    bool ok = false;
+#if defined(FICLONE)
+    ok = ioctl(out, FICLONE, in) == 0;
+#endif
+    if (!ok && st.st_size == 0)
+        ok = true;
+    if (!ok) {
+        void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, in, 0);
+        if (map != MAP_FAILED) {
+            madvise(map, st.st_size, MADV_SEQUENTIAL);
+            const char *p = static_cast<const char *>(map);
+            size_t left = st.st_size;
+            while (left > 0) {
+                ssize_t n = write(out, p, left);
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0)
+                    break;
+                p += n;
+                left -= n;
+            }
+            ok = left == 0;
+            munmap(map, st.st_size);
+        }
+    }
+    close(in);
+    if (close(out) != 0)
+        ok = false;
+    if (!ok)
+        unlink(dst.c_str());
+    return ok;
+}
+
+// 命中/未命中计数，多个进程同时运行时用 flock 串行化
+static void cache_record(const OutputCache &cache, bool hit) {
+    std::string path = cache.dir + "/stats";
+    int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+        return;
+    flock(fd, LOCK_EX);
+    char buf[128] = {0};
+    unsigned long long hits = 0, misses = 0;
+    if (pread(fd, buf, sizeof(buf) - 1, 0) > 0)
+        sscanf(buf, "hits %llu\nmisses %llu", &hits, &misses);
+    if (hit)
+        hits++;
+    else
+        misses++;
+    int len = snprintf(buf, sizeof(buf), "hits %llu\nmisses %llu\n", hits, misses);
+    if (ftruncate(fd, 0) == 0 && pwrite(fd, buf, len, 0) == len) {
+        unsigned long long total = hits + misses;
+        fprintf(stderr, "缓存%s: %s (命中 %llu / %llu, 命中率 %.1f%%)\n", hit ? "命中" : "未命中", cache.key.c_str(),
+                hits, total, total ? 100.0 * hits / total : 0.0);
+    }
+    flock(fd, LOCK_UN);
+    close(fd);
+}
+
+// 查找缓存：所有 role 都存在时复制到对应的输出路径并返回 true
+static bool cache_fetch(const OutputCache &cache, const char *const *roles, const char *const *outputs, int n) {
+    if (!cache.enabled)
+        return false;
+    for (int i = 0; i < n; i++) {
+        if (access(cache_entry_path(cache, roles[i]).c_str(), R_OK) != 0) {
+            cache_record(cache, false);
+            return false;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        std::string src = cache_entry_path(cache, roles[i]);
+        if (!cache_copy_file(src, outputs[i])) {
+            cache_record(cache, false);
+            return false;
+        }
+        utimensat(AT_FDCWD, src.c_str(), nullptr, 0); // 更新 mtime，作为 LRU 的使用时间
+    }
+    cache_record(cache, true);
+    return true;
+}
+
+struct CacheFile {
+    std::string name;
+    std::string key;
+    uint64_t size;
+    int64_t mtime;          // 纳秒
+};
+
+// 总大小超过预算时按条目最近使用时间淘汰，同一个键的文件一起删除
+static void cache_evict(const OutputCache &cache) {
+    DIR *d = opendir(cache.dir.c_str());
+    if (!d)
+        return;
+    std::vector<CacheFile> files;
+    uint64_t total = 0;
+    struct dirent *e;
+    while ((e = readdir(d)) != nullptr) {
+        std::string name = e->d_name;
+        size_t dot = name.find('.');
+        if (dot != 32)
+            continue; // 只处理 <键>.<role>，跳过 stats 和 . / ..
+        struct stat st;
+        if (stat((cache.dir + "/" + name).c_str(), &st) != 0)
+            continue;
+        files.push_back(CacheFile{name, name.substr(0, dot), (uint64_t)st.st_size,
+                                  (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec});
+        total += st.st_size;
+    }
+    closedir(d);
+    if (total <= cache.budget)
+        return;
+
+    // 条目的使用时间取其中最新的文件
+    std::sort(files.begin(), files.end(), [](const CacheFile &x, const CacheFile &y) { return x.key < y.key; });
+    for (size_t i = 0; i < files.size();) {
+        size_t j = i;
+        int64_t newest = 0;
+        for (; j < files.size() && files[j].key == files[i].key; j++)
+            newest = std::max(newest, files[j].mtime);
+        for (size_t k = i; k < j; k++)
+            files[k].mtime = newest;
+        i = j;
+    }
+    std::stable_sort(files.begin(), files.end(),
+                     [](const CacheFile &x, const CacheFile &y) { return x.mtime < y.mtime; });
+    for (size_t i = 0; i < files.size() && total > cache.budget; i++) {
+        if (files[i].key == cache.key)
+            continue; // 刚写入的条目不淘汰
+        if (unlink((cache.dir + "/" + files[i].name).c_str()) == 0)
+            total -= files[i].size;
+    }
+}
+
+// 成功生成输出后存入缓存：先写到临时文件再 rename，并发的读取方只会看到完整的文件
+static void cache_store(const OutputCache &cache, const char *const *roles, const char *const *outputs, int n) {
+    if (!cache.enabled)
+        return;
+    for (int i = 0; i < n; i++) {
+        std::string dst = cache_entry_path(cache, roles[i]);
+        std::string tmp = dst + ".tmp";
+        if (!cache_copy_file(outputs[i], tmp) || rename(tmp.c_str(), dst.c_str()) != 0) {
+            unlink(tmp.c_str());
+            return;
+        }
+    }
+    cache_evict(cache);
+}
+
+#endif // OUTPUT_CACHE_H
@@ -0,0 +1,265 @@
+#ifndef PLAYBACK_METRICS_H
+#define PLAYBACK_METRICS_H
+
+/*
+ * 长时间播放的运行指标导出：
+ *   - 渲染线程和音频回调只对无锁原子计数器做 relaxed 累加，不加锁、不做 IO
+ *   - 独立的指标线程按间隔生成 Prometheus 文本格式，
+ *     写入 <path>.tmp 后 rename 覆盖目标文件（读取方永远看到完整的一份），
+ *     和/或在 Unix 域套接字上监听，每个连接写入一份当前快照后关闭
+ */
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// 热路径上更新的计数器和测量值，全部为无锁原子变量
+struct PlaybackMetrics {
+    std::atomic<uint64_t> frames_rendered{0};    // 上传并显示的帧数
+    std::atomic<uint64_t> frames_dropped{0};     // 落后于时间表而跳过的帧数
+    std::atomic<uint64_t> audio_callbacks{0};
+    std::atomic<uint64_t> audio_underruns{0};    // 两次回调间隔超过两个缓冲区时长的次数
+    std::atomic<uint64_t> audio_callback_ns{0};  // 回调耗时累计
+    std::atomic<uint64_t> audio_callback_max_ns{0};
+    std::atomic<uint64_t> audio_bytes{0};        // 交给音频设备的字节数
+    std::atomic<int> video_queue_depth{0};       // 渲染线程取帧时已准备好的帧数
+    std::atomic<int> video_fps_x1000{25000};     // 视频帧率，用于换算视频时间
+    std::atomic<int> audio_bytes_per_second{0};
+};
+
+// 导出选项，两者都为空时不启动指标线程
+struct MetricsOptions {
+    std::string file;          // 原子重写的文本文件
+    std::string socket;        // Unix 域套接字路径
+    int interval_ms = 1000;    // 文件重写间隔
+};
+
+struct MetricsExporter {
+    PlaybackMetrics* metrics = nullptr;
+    MetricsOptions opts;
+    int listen_fd = -1;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool stop = false;
+};
+
+// 更新最大值：只在新值更大时 CAS，不阻塞其他线程
+static inline void metrics_update_max(std::atomic<uint64_t>& max, uint64_t value) {
+    uint64_t cur = max.load(std::memory_order_relaxed);
+    while (value > cur && !max.compare_exchange_weak(cur, value, std::memory_order_relaxed)) {
+    }
+}
+
+// 解析指标相关的选项，识别成功时返回 true 并移动下标
+static bool parse_metrics_option(int argc, char* argv[], int& i, MetricsOptions& opts) {
+    std::string arg = argv[i];
+    if (arg == "--metrics-file" && i + 1 < argc) {
+        opts.file = argv[++i];
+    } else if (arg == "--metrics-socket" && i + 1 < argc) {
+        opts.socket = argv[++i];
+    } else if (arg == "--metrics-interval" && i + 1 < argc) {
+        opts.interval_ms = atoi(argv[++i]);
+        if (opts.interval_ms < 10)
+            opts.interval_ms = 10;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static const char* metrics_options_usage() {
+    return "[--metrics-file 路径] [--metrics-socket 路径] [--metrics-interval 毫秒]";
+}
+
+// 常驻内存（RSS）字节数，来自 /proc/self/statm 的第二列
+static long long metrics_rss_bytes() {
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (!f)
+        return -1;
+    long long size = 0, resident = 0;
+    int n = fscanf(f, "%lld %lld", &size, &resident);
+    fclose(f);
+    return n == 2 ? resident * sysconf(_SC_PAGESIZE) : -1;
+}
+
+static void metrics_append(std::string& out, const char* name, const char* type, const char* help, double value) {
+    char line[512];
+    snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n%s %.9g\n", name, help, name, type, name, value);
+    out += line;
+}
+
+// 读取一份快照并生成 Prometheus 文本格式
+static std::string metrics_render(const PlaybackMetrics& m) {
+    const std::memory_order relaxed = std::memory_order_relaxed;
+    uint64_t rendered = m.frames_rendered.load(relaxed);
+    uint64_t dropped = m.frames_dropped.load(relaxed);
+    uint64_t audio_bytes = m.audio_bytes.load(relaxed);
+    int fps_x1000 = m.video_fps_x1000.load(relaxed);
+    int bps = m.audio_bytes_per_second.load(relaxed);
+
+    std::string out;
+    metrics_append(out, "ffdemo_video_frames_rendered_total", "counter", "Frames uploaded and presented.", rendered);
+    metrics_append(out, "ffdemo_video_frames_dropped_total", "counter", "Frames skipped to catch up with the schedule.",
+                   dropped);
+    metrics_append(out, "ffdemo_video_queue_depth", "gauge", "Prepared frames queued when the renderer took the next one.",
+                   m.video_queue_depth.load(relaxed));
+    metrics_append(out, "ffdemo_audio_callbacks_total", "counter", "Audio callbacks.", m.audio_callbacks.load(relaxed));
+    metrics_append(out, "ffdemo_audio_underruns_total", "counter",
+                   "Audio callbacks that arrived more than two buffer periods after the previous one.",
+                   m.audio_underruns.load(relaxed));
+    metrics_append(out, "ffdemo_audio_callback_seconds_total", "counter", "Time spent inside the audio callback.",
+                   m.audio_callback_ns.load(relaxed) / 1e9);
+    metrics_append(out, "ffdemo_audio_callback_max_seconds", "gauge", "Longest single audio callback.",
+                   m.audio_callback_max_ns.load(relaxed) / 1e9);
+    metrics_append(out, "ffdemo_audio_bytes_total", "counter", "Bytes handed to the audio device.", audio_bytes);
+
+    // 视频时间 = 已处理帧数 / 帧率，音频时间 = 已送出字节 / 字节率；正值表示视频超前
+    if (fps_x1000 > 0 && bps > 0) {
+        double video_seconds = (rendered + dropped) * 1000.0 / fps_x1000;
+        double audio_seconds = (double)audio_bytes / bps;
+        metrics_append(out, "ffdemo_av_offset_seconds", "gauge", "Video position minus audio position.",
+                       video_seconds - audio_seconds);
+    }
+    metrics_append(out, "ffdemo_resident_memory_bytes", "gauge", "Resident set size from /proc/self/statm.",
+                   (double)metrics_rss_bytes());
+    return out;
+}
+
+static bool metrics_write_all(int fd, const std::string& text) {
+    size_t done = 0;
+    while (done < text.size()) {
+        ssize_t n = write(fd, text.data() + done, text.size() - done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        done += n;
+    }
+    return true;
+}
+
+// 写入临时文件后 rename，读取方不会看到写了一半的内容
+static void metrics_write_file(const std::string& path, const std::string& text) {
+    std::string tmp = path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "w");
+    if (!f)
+        return;
+    bool ok = fwrite(text.data(), 1, text.size(), f) == text.size();
+    ok = fclose(f) == 0 && ok;
+    if (ok)
+        rename(tmp.c_str(), path.c_str());
+    else
+        unlink(tmp.c_str());
+}
+
+static int metrics_listen(const std::string& path) {
+    struct sockaddr_un addr;
+    if (path.size() >= sizeof(addr.sun_path))
+        return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path.c_str());
+    unlink(path.c_str()); // 上次异常退出留下的套接字文件
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 4) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// 指标线程：按间隔重写文件，其余时间等待套接字连接
+static void metrics_worker(MetricsExporter* exp) {
+    using clock = std::chrono::steady_clock;
+    clock::time_point next_write = clock::now();
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(exp->mutex);
+            if (exp->stop)
+                break;
+        }
+        clock::time_point now = clock::now();
+        if (!exp->opts.file.empty() && now >= next_write) {
+            metrics_write_file(exp->opts.file, metrics_render(*exp->metrics));
+            next_write = now + std::chrono::milliseconds(exp->opts.interval_ms);
+        }
+
+        int wait_ms = exp->opts.interval_ms;
+        if (!exp->opts.file.empty())
+            wait_ms = (int)std::chrono::duration_cast<std::chrono::milliseconds>(next_write - clock::now()).count();
+        if (wait_ms < 0)
+            wait_ms = 0;
+        // 等待期间每100毫秒检查一次是否需要退出
+        if (wait_ms > 100)
+            wait_ms = 100;
+
+        if (exp->listen_fd < 0) {
+            std::unique_lock<std::mutex> lock(exp->mutex);
+            exp->cond.wait_for(lock, std::chrono::milliseconds(wait_ms), [&]() { return exp->stop; });
+            continue;
+        }
+        struct pollfd pfd;
+        pfd.fd = exp->listen_fd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, wait_ms) > 0) {
+            int client = accept(exp->listen_fd, nullptr, nullptr);
+            if (client >= 0) {
+                metrics_write_all(client, metrics_render(*exp->metrics));
+                close(client);
+            }
+        }
+    }
+    if (!exp->opts.file.empty())
+        metrics_write_file(exp->opts.file, metrics_render(*exp->metrics));
+}
+
+// 按选项启动指标线程，没有配置输出时什么也不做
+static bool metrics_start(MetricsExporter& exp, PlaybackMetrics& metrics, const MetricsOptions& opts) {
+    exp.metrics = &metrics;
+    exp.opts = opts;
+    if (opts.file.empty() && opts.socket.empty())
+        return true;
+    if (!opts.socket.empty()) {
+        exp.listen_fd = metrics_listen(opts.socket);
+        if (exp.listen_fd < 0) {
+            fprintf(stderr, "无法监听指标套接字: %s\n", opts.socket.c_str());
+            return false;
+        }
+    }
+    exp.worker = std::thread(metrics_worker, &exp);
+    return true;
+}
+
+// 停止指标线程（最后写一次文件），删除套接字文件
+static void metrics_stop(MetricsExporter& exp) {
+    {
+        std::lock_guard<std::mutex> lock(exp.mutex);
+        exp.stop = true;
+        exp.cond.notify_all();
+    }
+    if (exp.worker.joinable())
+        exp.worker.join();
+    if (exp.listen_fd >= 0) {
+        close(exp.listen_fd);
+        unlink(exp.opts.socket.c_str());
+        exp.listen_fd = -1;
+    }
+}
+
+#endif // PLAYBACK_METRICS_H
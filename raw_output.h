@@ -0,0 +1,326 @@
+#ifndef RAW_OUTPUT_H
+#define RAW_OUTPUT_H
+
+/*
+ * save_yuv / save_pcm 共用的原始输出写入层：
+ *   - 默认使用 stdio 缓冲写入，与原来的 fwrite 相同
+ *   - --direct-io 时绕过页缓存：Linux 上用 O_DIRECT 打开（macOS 用 F_NOCACHE），数据先拷贝进
+ *     按页对齐的缓冲区，写满一块就提交；用 -DHAVE_LIBURING 编译（make URING=1）时通过 io_uring
+ *     异步提交，最多 RAW_OUTPUT_DEPTH 个写请求同时在途，否则用同步 pwrite
+ *   - 刷新（记录断点、跟随模式每帧）和关闭时，不满一个对齐块的尾部通过普通 fd 写出，
+ *     并留在缓冲区开头，之后的对齐写入会覆盖它
+ *   - 文件系统不支持 O_DIRECT（如 tmpfs）时退回普通写入，每写完一块用 fadvise 丢掉页缓存
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include "checkpoint.h"
+
+// 对齐粒度：覆盖常见设备的逻辑块大小和页大小
+static const size_t RAW_OUTPUT_ALIGN = 4096;
+// 每个缓冲区的大小和缓冲区个数（即同时在途的写请求数）
+static const size_t RAW_OUTPUT_CHUNK = 1 << 20;
+static const int RAW_OUTPUT_DEPTH = 4;
+
+struct RawOutput {
+    FILE *file = nullptr;           // 缓冲写入模式
+    bool direct = false;
+    bool dontneed = false;          // 不支持 O_DIRECT 时改为写完后丢掉页缓存
+    int fd = -1;                    // 对齐写入用的 fd
+    int tail_fd = -1;               // 写出不对齐的尾部、恢复时读回尾部用的普通 fd
+    uint8_t *bufs[RAW_OUTPUT_DEPTH] = {nullptr};
+    bool busy[RAW_OUTPUT_DEPTH] = {false};
+    uint64_t offsets[RAW_OUTPUT_DEPTH] = {0}; // 在途请求的文件偏移
+    int cur = 0;                    // 正在填充的缓冲区
+    size_t fill = 0;                // 当前缓冲区中的字节数
+    uint64_t pos = 0;               // 当前缓冲区在文件中的偏移，总是对齐的
+    int inflight = 0;
+    bool error = false;
+#ifdef HAVE_LIBURING
+    struct io_uring ring;
+    bool uring = false;
+#endif
+};
+
+// 完整写出一段数据，处理被信号打断和部分写入
+static bool raw_pwrite_all(int fd, const uint8_t *p, size_t len, uint64_t offset) {
+    while (len > 0) {
+        ssize_t n = pwrite(fd, p, len, (off_t)offset);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        len -= n;
+        offset += n;
+    }
+    return true;
+}
+
+// 一个对齐块写入完成
+static void raw_output_done(RawOutput *out, int idx, uint64_t offset, size_t len) {
+    out->busy[idx] = false;
+#ifdef POSIX_FADV_DONTNEED
+    if (out->dontneed) {
+        // 普通写入的页要先写回才能丢掉
+        fdatasync(out->fd);
+        posix_fadvise(out->fd, (off_t)offset, (off_t)len, POSIX_FADV_DONTNEED);
+    }
+#else
+    (void)offset;
+    (void)len;
+#endif
+}
+
+#ifdef HAVE_LIBURING
+// 等待一个写请求完成；部分写入时同步补齐剩余部分
+static void raw_output_reap(RawOutput *out) {
+    struct io_uring_cqe *cqe;
+    int ret;
+    do {
+        ret = io_uring_wait_cqe(&out->ring, &cqe);
+    } while (ret == -EINTR);
+    if (ret < 0) {
+        out->error = true;
+        out->inflight = 0;
+        for (int i = 0; i < RAW_OUTPUT_DEPTH; i++)
+            out->busy[i] = false;
+        return;
+    }
+    int idx = (int)cqe->user_data;  // 缓冲区下标
+    int res = cqe->res;
+    io_uring_cqe_seen(&out->ring, cqe);
+    out->inflight--;
+
+    uint64_t offset = out->offsets[idx];
+    if (res < 0) {
+        out->error = true;
+    } else if ((size_t)res < RAW_OUTPUT_CHUNK &&
+               !raw_pwrite_all(out->fd, out->bufs[idx] + res, RAW_OUTPUT_CHUNK - res, offset + res)) {
+        out->error = true;
+    }
+    raw_output_done(out, idx, offset, RAW_OUTPUT_CHUNK);
+}
+#endif
+
+// 等待所有在途的写请求完成
+static void raw_output_drain(RawOutput *out) {
+#ifdef HAVE_LIBURING
+    while (out->inflight > 0)
+        raw_output_reap(out);
+#else
+    (void)out;
+#endif
+}
+
+#ifdef HAVE_LIBURING
+// 提交已准备好的 SQE：被打断或内核暂时没有资源时先收割完成的请求再重试，返回是否提交成功
+static bool raw_output_submit_sqe(RawOutput *out) {
+    while (true) {
+        int ret = io_uring_submit(&out->ring);
+        if (ret > 0)
+            return true;
+        if (ret == -EINTR)
+            continue;
+        if ((ret == -EAGAIN || ret == -EBUSY) && out->inflight > 0) {
+            raw_output_reap(out);
+            continue;
+        }
+        return false;
+    }
+}
+
+// 提交出错后 SQE 仍留在提交队列里，下次提交会被送进内核，所以等在途请求完成后销毁 ring，
+// 之后一直使用同步写入
+static void raw_output_disable_uring(RawOutput *out) {
+    fprintf(stderr, "io_uring 提交失败，改用同步写入\n");
+    raw_output_drain(out);
+    io_uring_queue_exit(&out->ring);
+    out->uring = false;
+}
+#endif
+
+// 提交当前已写满的缓冲区
+static void raw_output_submit(RawOutput *out) {
+    int idx = out->cur;
+    out->busy[idx] = true;
+#ifdef HAVE_LIBURING
+    if (out->uring) {
+        struct io_uring_sqe *sqe = io_uring_get_sqe(&out->ring);
+        if (sqe) {
+            io_uring_prep_write(sqe, out->fd, out->bufs[idx], RAW_OUTPUT_CHUNK, out->pos);
+            sqe->user_data = idx;
+            out->offsets[idx] = out->pos;
+            if (raw_output_submit_sqe(out)) {
+                out->inflight++;
+                return;
+            }
+            raw_output_disable_uring(out);
+        }
+        // 没有空闲的 SQE 时这个缓冲区同步写出，ring 中没有留下它的请求
+    }
+#endif
+    if (!raw_pwrite_all(out->fd, out->bufs[idx], RAW_OUTPUT_CHUNK, out->pos))
+        out->error = true;
+    raw_output_done(out, idx, out->pos, RAW_OUTPUT_CHUNK);
+}
+
+static bool raw_output_close(RawOutput *out);
+
+// 打开失败时释放已经分配的资源
+static bool raw_output_fail(RawOutput *out) {
+    out->fill = 0;
+    raw_output_close(out);
+    return false;
+}
+
+/*
+ * 打开输出。keep_bytes < 0 时新建/清空文件；否则保留前 keep_bytes 字节（从断点恢复），
+ * 之后从这里继续写。direct 为 false 时就是普通的 FILE*。
+ */
+static bool raw_output_open(RawOutput *out, const char *path, int64_t keep_bytes, bool direct) {
+    if (!direct) {
+        out->file = keep_bytes < 0 ? fopen(path, "wb") : checkpoint_reopen_output(path, (uint64_t)keep_bytes);
+        return out->file != nullptr;
+    }
+
+    out->direct = true;
+    int flags = O_WRONLY | O_CREAT;
+    if (keep_bytes < 0)
+        flags |= O_TRUNC;
+#ifdef O_DIRECT
+    out->fd = open(path, flags | O_DIRECT, 0644);
+    if (out->fd < 0 && errno == EINVAL) {
+        fprintf(stderr, "文件系统不支持 O_DIRECT，改为写完后丢弃页缓存: %s\n", path);
+        out->fd = open(path, flags, 0644);
+        out->dontneed = true;
+    }
+#else
+    out->fd = open(path, flags, 0644);
+#if defined(F_NOCACHE)
+    if (out->fd >= 0)
+        fcntl(out->fd, F_NOCACHE, 1);
+#else
+    out->dontneed = true;
+#endif
+#endif
+    if (out->fd < 0)
+        return false;
+    out->tail_fd = open(path, O_RDWR);
+    if (out->tail_fd < 0)
+        return raw_output_fail(out);
+
+    for (int i = 0; i < RAW_OUTPUT_DEPTH; i++) {
+        void *p = nullptr;
+        if (posix_memalign(&p, RAW_OUTPUT_ALIGN, RAW_OUTPUT_CHUNK) != 0)
+            return raw_output_fail(out);
+        out->bufs[i] = static_cast<uint8_t *>(p);
+    }
+
+    // 恢复时截断到断点，把最后一个不完整的对齐块读回缓冲区
+    if (keep_bytes >= 0) {
+        struct stat st;
+        if (fstat(out->tail_fd, &st) != 0 || st.st_size < keep_bytes || ftruncate(out->tail_fd, keep_bytes) != 0)
+            return raw_output_fail(out);
+        out->pos = (uint64_t)keep_bytes & ~(uint64_t)(RAW_OUTPUT_ALIGN - 1);
+        out->fill = (size_t)((uint64_t)keep_bytes - out->pos);
+        if (out->fill > 0 && pread(out->tail_fd, out->bufs[0], out->fill, (off_t)out->pos) != (ssize_t)out->fill)
+            return raw_output_fail(out);
+    }
+
+#ifdef HAVE_LIBURING
+    out->uring = io_uring_queue_init(RAW_OUTPUT_DEPTH, &out->ring, 0) == 0;
+    if (!out->uring)
+        fprintf(stderr, "无法初始化 io_uring，改用同步写入\n");
+#endif
+    return true;
+}
+
+static void raw_output_write(RawOutput *out, const void *data, size_t len) {
+    if (!out->direct) {
+        fwrite(data, 1, len, out->file);
+        return;
+    }
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    while (len > 0) {
+        size_t n = RAW_OUTPUT_CHUNK - out->fill;
+        if (n > len)
+            n = len;
+        memcpy(out->bufs[out->cur] + out->fill, p, n);
+        out->fill += n;
+        p += n;
+        len -= n;
+        if (out->fill < RAW_OUTPUT_CHUNK)
+            break;
+
+        // 写满一块后提交，切换到下一个缓冲区，必要时等待它之前的写请求完成
+        raw_output_submit(out);
+        out->pos += RAW_OUTPUT_CHUNK;
+        out->cur = (out->cur + 1) % RAW_OUTPUT_DEPTH;
+        out->fill = 0;
+#ifdef HAVE_LIBURING
+        while (out->busy[out->cur])
+            raw_output_reap(out);
+#endif
+    }
+}
+
+// 把已写入的数据全部交给内核：对齐部分用直接 I/O 写出，不对齐的尾部用普通 fd 写出并保留在缓冲区
+static void raw_output_flush(RawOutput *out) {
+    if (!out->direct) {
+        fflush(out->file);
+        return;
+    }
+    raw_output_drain(out);
+    uint8_t *buf = out->bufs[out->cur];
+    size_t aligned = out->fill & ~(RAW_OUTPUT_ALIGN - 1);
+    size_t tail = out->fill - aligned;
+    if (aligned > 0) {
+        if (!raw_pwrite_all(out->fd, buf, aligned, out->pos))
+            out->error = true;
+        raw_output_done(out, out->cur, out->pos, aligned);
+        memmove(buf, buf + aligned, tail);
+        out->pos += aligned;
+        out->fill = tail;
+    }
+    if (tail > 0 && !raw_pwrite_all(out->tail_fd, buf, tail, out->pos))
+        out->error = true;
+}
+
+// 关闭输出，任何一次写入失败都返回 false
+static bool raw_output_close(RawOutput *out) {
+    if (!out->direct) {
+        bool ok = out->file && fclose(out->file) == 0;
+        out->file = nullptr;
+        return ok;
+    }
+    raw_output_flush(out);
+#ifdef HAVE_LIBURING
+    if (out->uring)
+        io_uring_queue_exit(&out->ring);
+    out->uring = false;
+#endif
+    for (int i = 0; i < RAW_OUTPUT_DEPTH; i++) {
+        free(out->bufs[i]);
+        out->bufs[i] = nullptr;
+    }
+    if (out->fd >= 0 && close(out->fd) != 0)
+        out->error = true;
+    if (out->tail_fd >= 0 && close(out->tail_fd) != 0)
+        out->error = true;
+    out->fd = out->tail_fd = -1;
+    return !out->error;
+}
+
+#endif // RAW_OUTPUT_H
@@ -1,15 +1,34 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 
 extern "C" {
     #include <libavutil/frame.h>
+    #include <libavutil/mathematics.h>
     #include <libavutil/mem.h>
+    #include <libavutil/samplefmt.h>
+    #include <libavutil/time.h>
     #include <libavcodec/avcodec.h>
 }
 
+#include "simd_kernels.h"
+#include "input_io.h"
+#include "checkpoint.h"
+#include "output_cache.h"
+#include "adts.h"
+#include "raw_output.h"
+
 #define AUDIO_INBUF_SIZE 20480
 #define AUDIO_REFILL_THRESH 4096
+#define AUDIO_MAP_CHUNK (1 << 20) // 映射区每次交给解析器的最大字节数
+
+// 波形概览：最底层每个峰值条目覆盖的采样数，上层逐级合并两个条目
+#define PEAK_BASE_BLOCK 256
+#define PEAK_FILE_VERSION 1
+
+// 断点的最小记录间隔（微秒）
+#define CHECKPOINT_INTERVAL_US 1000000
 
 // 错误处理缓冲区
 static char err_buf[128] = {0};
@@ -29,10 +48,487 @@ static void print_sample_format(const AVFrame *frame)
     printf("格式: %u\n", frame->format); // 注意：实际存储到本地文件时已经改成交错模式
 }
 
-// 解码函数，将音频包解码成音频帧并写入输出文件
-static void decode(AVCodecContext *dec_ctx, AVPacket *pkt, AVFrame *frame, FILE *outfile)
+/*
+ * 波形概览文件（<输出文件>.peaks）的布局，全部为小端，可以直接 mmap 使用：
+ *   PeakFileHeader
+ *   PeakLevel[num_levels]    第 l 层每个条目覆盖 base_block << l 个采样
+ *   各层数据                 每个条目按声道交错存放 {int16 min, int16 max, int16 rms}
+ */
+typedef struct PeakFileHeader {
+    char magic[4];          // "PEAK"
+    uint32_t version;
+    uint32_t sample_rate;
+    uint32_t channels;
+    uint32_t base_block;
+    uint32_t num_levels;
+    uint64_t total_samples;
+} PeakFileHeader;
+
+typedef struct PeakLevel {
+    uint64_t offset;        // 该层数据相对文件开头的偏移
+    uint64_t count;         // 该层条目数
+} PeakLevel;
+
+// 单个声道的一个峰值条目
+typedef struct PeakEntry {
+    float min;
+    float max;
+    double sumsq;
+} PeakEntry;
+
+// 解码过程中累积最底层峰值条目
+typedef struct PeakBuilder {
+    int channels;
+    int sample_rate;
+    int block_fill;         // 当前块已累积的采样数
+    PeakEntry *cur;         // 当前块，每个声道一个
+    PeakEntry *entries;     // 已完成的最底层条目，按声道交错
+    size_t count;
+    size_t capacity;
+    uint64_t total_samples;
+    const float **planes;   // 当前帧每个声道的浮点采样
+    float *conv_buf;        // 非平面浮点格式转换用的临时缓冲区
+    int conv_size;
+} PeakBuilder;
+
+static void peak_reset_block(PeakBuilder *pb)
+{
+    for (int ch = 0; ch < pb->channels; ch++)
+    {
+        pb->cur[ch].min = INFINITY;
+        pb->cur[ch].max = -INFINITY;
+        pb->cur[ch].sumsq = 0.0;
+    }
+    pb->block_fill = 0;
+}
+
+static void peak_init(PeakBuilder *pb, int channels, int sample_rate)
+{
+    memset(pb, 0, sizeof(*pb));
+    pb->channels = channels;
+    pb->sample_rate = sample_rate;
+    pb->cur = (PeakEntry *)malloc(sizeof(PeakEntry) * channels);
+    pb->planes = (const float **)malloc(sizeof(float *) * channels);
+    peak_reset_block(pb);
+}
+
+static void peak_free(PeakBuilder *pb)
+{
+    free(pb->cur);
+    free(pb->planes);
+    free(pb->entries);
+    free(pb->conv_buf);
+    memset(pb, 0, sizeof(*pb));
+}
+
+// 把当前块追加到最底层条目中
+static void peak_flush_block(PeakBuilder *pb)
+{
+    if (pb->block_fill == 0)
+        return;
+    if (pb->count == pb->capacity)
+    {
+        pb->capacity = pb->capacity ? pb->capacity * 2 : 4096;
+        pb->entries = (PeakEntry *)realloc(pb->entries, sizeof(PeakEntry) * pb->channels * pb->capacity);
+        if (!pb->entries)
+        {
+            fprintf(stderr, "无法分配波形概览内存\n");
+            exit(1);
+        }
+    }
+    memcpy(pb->entries + pb->count * pb->channels, pb->cur, sizeof(PeakEntry) * pb->channels);
+    pb->count++;
+    peak_reset_block(pb);
+}
+
+// 取得某个声道的浮点采样，平面浮点格式直接返回帧数据，其它格式转换到临时缓冲区中该声道的位置
+static const float *peak_channel_samples(PeakBuilder *pb, const AVFrame *frame, int ch)
+{
+    enum AVSampleFormat fmt = (enum AVSampleFormat)frame->format;
+    if (fmt == AV_SAMPLE_FMT_FLTP)
+        return (const float *)frame->extended_data[ch];
+
+    int planar = av_sample_fmt_is_planar(fmt);
+    int step = planar ? 1 : pb->channels;
+    const uint8_t *src = frame->extended_data[planar ? ch : 0];
+    float *dst = pb->conv_buf + (size_t)ch * frame->nb_samples;
+    for (int i = 0; i < frame->nb_samples; i++)
+    {
+        int idx = (planar ? 0 : ch) + i * step;
+        float v;
+        switch (fmt)
+        {
+        case AV_SAMPLE_FMT_U8:
+        case AV_SAMPLE_FMT_U8P:  v = (src[idx] - 128) / 128.0f; break;
+        case AV_SAMPLE_FMT_S16:
+        case AV_SAMPLE_FMT_S16P: v = ((const int16_t *)src)[idx] / 32768.0f; break;
+        case AV_SAMPLE_FMT_S32:
+        case AV_SAMPLE_FMT_S32P: v = ((const int32_t *)src)[idx] / 2147483648.0f; break;
+        case AV_SAMPLE_FMT_FLT:  v = ((const float *)src)[idx]; break;
+        case AV_SAMPLE_FMT_DBL:
+        case AV_SAMPLE_FMT_DBLP: v = (float)((const double *)src)[idx]; break;
+        default:                 v = 0.0f; break;
+        }
+        dst[i] = v;
+    }
+    return dst;
+}
+
+// 把一个解码后的音频帧累积进峰值块
+static void peak_add_frame(PeakBuilder *pb, const AVFrame *frame)
+{
+    if (frame->format != AV_SAMPLE_FMT_FLTP && pb->conv_size < frame->nb_samples)
+    {
+        pb->conv_size = frame->nb_samples;
+        pb->conv_buf = (float *)realloc(pb->conv_buf, sizeof(float) * pb->channels * pb->conv_size);
+    }
+    for (int ch = 0; ch < pb->channels; ch++)
+        pb->planes[ch] = peak_channel_samples(pb, frame, ch);
+
+    int done = 0;
+    while (done < frame->nb_samples)
+    {
+        int n = PEAK_BASE_BLOCK - pb->block_fill;
+        if (n > frame->nb_samples - done)
+            n = frame->nb_samples - done;
+        for (int ch = 0; ch < pb->channels; ch++)
+            peak_reduce_simd(pb->planes[ch] + done, n, &pb->cur[ch].min, &pb->cur[ch].max, &pb->cur[ch].sumsq);
+        pb->block_fill += n;
+        done += n;
+        if (pb->block_fill == PEAK_BASE_BLOCK)
+            peak_flush_block(pb);
+    }
+    pb->total_samples += frame->nb_samples;
+}
+
+static int16_t peak_quantize(double v)
+{
+    if (v > 1.0)
+        v = 1.0;
+    else if (v < -1.0)
+        v = -1.0;
+    return (int16_t)lrint(v * 32767.0);
+}
+
+// 逐级合并生成多分辨率金字塔，并写入概览文件
+static int peak_write(PeakBuilder *pb, const char *filename)
+{
+    peak_flush_block(pb);
+    if (pb->count == 0)
+        return -1;
+
+    // 计算层数和每层条目数，直到最顶层只剩一个条目
+    PeakLevel levels[64];
+    uint32_t num_levels = 0;
+    uint64_t count = pb->count;
+    uint64_t offset = sizeof(PeakFileHeader);
+    while (1)
+    {
+        levels[num_levels].count = count;
+        num_levels++;
+        if (count == 1)
+            break;
+        count = (count + 1) / 2;
+    }
+    offset += sizeof(PeakLevel) * num_levels;
+    for (uint32_t l = 0; l < num_levels; l++)
+    {
+        levels[l].offset = offset;
+        offset += levels[l].count * pb->channels * 3 * sizeof(int16_t);
+    }
+
+    FILE *f = fopen(filename, "wb");
+    if (!f)
+    {
+        fprintf(stderr, "无法打开波形概览文件 %s\n", filename);
+        return -1;
+    }
+    PeakFileHeader header;
+    memcpy(header.magic, "PEAK", 4);
+    header.version = PEAK_FILE_VERSION;
+    header.sample_rate = pb->sample_rate;
+    header.channels = pb->channels;
+    header.base_block = PEAK_BASE_BLOCK;
+    header.num_levels = num_levels;
+    header.total_samples = pb->total_samples;
+    fwrite(&header, sizeof(header), 1, f);
+    fwrite(levels, sizeof(PeakLevel), num_levels, f);
+
+    // 逐层写出，写完一层后在原地两两合并得到上一层
+    PeakEntry *cur = pb->entries;
+    int16_t *out = (int16_t *)malloc(sizeof(int16_t) * 3 * pb->channels * pb->count);
+    uint64_t block = PEAK_BASE_BLOCK;
+    for (uint32_t l = 0; l < num_levels; l++)
+    {
+        uint64_t n = levels[l].count;
+        for (uint64_t i = 0; i < n; i++)
+        {
+            // 最后一个条目可能不满，按实际采样数计算 RMS
+            uint64_t covered = (i + 1 == n) ? pb->total_samples - i * block : block;
+            for (int ch = 0; ch < pb->channels; ch++)
+            {
+                const PeakEntry *e = &cur[i * pb->channels + ch];
+                int16_t *o = out + (i * pb->channels + ch) * 3;
+                o[0] = peak_quantize(e->min);
+                o[1] = peak_quantize(e->max);
+                o[2] = peak_quantize(sqrt(e->sumsq / (double)covered));
+            }
+        }
+        fwrite(out, sizeof(int16_t) * 3 * pb->channels, n, f);
+
+        for (uint64_t i = 0; i < n / 2 + n % 2; i++)
+        {
+            for (int ch = 0; ch < pb->channels; ch++)
+            {
+                PeakEntry merged = cur[2 * i * pb->channels + ch];
+                if (2 * i + 1 < n)
+                {
+                    const PeakEntry *b = &cur[(2 * i + 1) * pb->channels + ch];
+                    merged.min = b->min < merged.min ? b->min : merged.min;
+                    merged.max = b->max > merged.max ? b->max : merged.max;
+                    merged.sumsq += b->sumsq;
+                }
+                cur[i * pb->channels + ch] = merged;
+            }
+        }
+        block *= 2;
+    }
+    free(out);
+    fclose(f);
+    printf("波形概览: %s (%u 层, %llu 采样)\n", filename, num_levels, (unsigned long long)pb->total_samples);
+    return 0;
+}
+
+// 从已写出的交错PCM重建波形概览，用于从断点恢复时接上之前的部分
+static int peak_rebuild(PeakBuilder *pb, FILE *f, uint64_t bytes, enum AVSampleFormat fmt, int channels, int sample_rate)
+{
+    enum AVSampleFormat packed = av_get_packed_sample_fmt(fmt);
+    const int frame_bytes = av_get_bytes_per_sample(packed) * channels;
+    const int chunk_samples = 4096;
+    uint8_t *buf = (uint8_t *)malloc((size_t)frame_bytes * chunk_samples);
+    AVFrame *frame = av_frame_alloc();
+    if (!buf || !frame || frame_bytes <= 0)
+    {
+        free(buf);
+        av_frame_free(&frame);
+        return -1;
+    }
+
+    peak_init(pb, channels, sample_rate);
+    frame->format = packed;
+    frame->extended_data = frame->data;
+    frame->data[0] = buf;
+    fseeko(f, 0, SEEK_SET);
+    uint64_t left = bytes / frame_bytes;
+    int ret = 0;
+    while (left > 0)
+    {
+        int n = left > (uint64_t)chunk_samples ? chunk_samples : (int)left;
+        if (fread(buf, frame_bytes, n, f) != (size_t)n)
+        {
+            ret = -1;
+            break;
+        }
+        frame->nb_samples = n;
+        peak_add_frame(pb, frame);
+        left -= n;
+    }
+    fseeko(f, 0, SEEK_END);
+
+    frame->data[0] = NULL;
+    av_frame_free(&frame);
+    free(buf);
+    return ret;
+}
+
+/*
+ * 断点状态。ADTS 的每个包都可以独立开始解码，但第一个包只输出重叠窗口的一半，
+ * 所以断点记录的是最后一个已解码包的偏移（预滚包）和到它为止写出的采样数：
+ * 恢复时从预滚包开始解码并丢弃它的输出，下一个包的输出与不中断时一致。
+ */
+typedef struct PcmCheckpoint {
+    char path[1024];
+    int enabled;            // 输入为普通文件时才记录断点
+    int64_t base_offset;    // 解析器从输入的这个偏移开始接收数据
+    int64_t packet_pos;     // 当前包在输入中的偏移
+    int preroll;            // 还需要解码但丢弃输出的包数
+    uint64_t samples;       // 已写出的采样数（每声道）
+    int64_t input_size;
+    int64_t last_write;     // 上次记录断点的时间
+    int sample_fmt;
+    int channels;
+    int sample_rate;
+} PcmCheckpoint;
+
+// 距离上次记录超过间隔时刷新输出并记录断点
+static void pcm_checkpoint_maybe(PcmCheckpoint *ckpt, RawOutput *out)
+{
+    if (!ckpt->enabled || ckpt->channels == 0)
+        return;
+    int64_t now = av_gettime_relative();
+    if (now - ckpt->last_write < CHECKPOINT_INTERVAL_US)
+        return;
+    ckpt->last_write = now;
+    raw_output_flush(out);
+    Checkpoint c;
+    c.input_pos = ckpt->packet_pos;
+    c.output_bytes = ckpt->samples * ckpt->channels * av_get_bytes_per_sample((enum AVSampleFormat)ckpt->sample_fmt);
+    c.units = ckpt->samples;
+    c.input_size = ckpt->input_size;
+    c.param[0] = ckpt->sample_fmt;
+    c.param[1] = ckpt->channels;
+    c.param[2] = ckpt->sample_rate;
+    checkpoint_write(ckpt->path, &c);
+}
+
+/*
+ * --start/--duration 指定的时间范围。ADTS 输入先逐帧扫描头部（不解码）找到包含起点的帧，
+ * 从它的前一帧开始解码并丢弃这一帧的输出作为预滚，之后按采样精确裁剪到范围内。
+ * 无法扫描的输入（MP3、管道等）从头解码，只做裁剪。
+ */
+typedef struct PcmRange {
+    int active;
+    double start;           // 秒
+    double duration;        // 秒，0 表示到输入结尾
+    int64_t first_sample;   // 第一个保留的包在输入中的起始采样，以 core_rate 计
+    int core_rate;          // ADTS 头中的采样率，未扫描时为 0
+    int64_t next_sample;    // 下一个解码帧的起始采样（输出采样率），-1 表示还没有输出
+    int64_t start_sample;   // 范围 [start_sample, end_sample)，输出采样率
+    int64_t end_sample;
+    int done;               // 已经输出到范围结尾，不必再解析后面的输入
+} PcmRange;
+
+// 扫描 ADTS 帧头找到包含起点的帧，给出开始解码的偏移和预滚包数；不是 ADTS 输入时返回 -1
+static int adts_find_start(const uint8_t *data, size_t size, PcmRange *range, int64_t *offset, int *preroll)
+{
+    size_t pos = 0, prev_pos = 0;
+    int64_t sample = 0;
+    int rate = 0, samples = 0;
+    while (1)
+    {
+        int len = adts_parse_header(data + pos, size - pos, &rate, &samples);
+        if (len < 0)
+            return pos == 0 ? -1 : -2;
+        if (sample + samples > llrint(range->start * rate))
+            break;
+        prev_pos = pos;
+        pos += len;
+        sample += samples;
+        if (pos >= size)
+            return -2;
+    }
+    *offset = pos > 0 ? (int64_t)prev_pos : 0;
+    *preroll = pos > 0 ? 1 : 0;
+    range->first_sample = sample;
+    range->core_rate = rate;
+    return 0;
+}
+
+// 把帧的 [begin, end) 采样移到开头，原地裁剪；源和目标重叠，逐个平面用 memmove
+static int trim_frame(AVFrame *frame, int begin, int end)
+{
+    if (begin == 0 && end == frame->nb_samples)
+        return 0;
+    int ret = av_frame_make_writable(frame);
+    if (ret < 0)
+        return ret;
+    if (begin > 0)
+    {
+        enum AVSampleFormat fmt = (enum AVSampleFormat)frame->format;
+        const int channels = frame->ch_layout.nb_channels;
+        const int planar = av_sample_fmt_is_planar(fmt);
+        const int planes = planar ? channels : 1;
+        const size_t sample_bytes = (size_t)av_get_bytes_per_sample(fmt) * (planar ? 1 : channels);
+        for (int p = 0; p < planes; p++)
+            memmove(frame->extended_data[p], frame->extended_data[p] + begin * sample_bytes,
+                    (end - begin) * sample_bytes);
+    }
+    frame->nb_samples = end - begin;
+    return 0;
+}
+
+// 计算帧与时间范围的交集并裁剪帧，返回 0 表示整帧都在范围之外
+static int range_clip(PcmRange *range, AVFrame *frame)
+{
+    if (!range->active)
+        return 1;
+    if (range->next_sample < 0)
+    {
+        // 第一个输出帧：确定输出采样率下的起点（HE-AAC 的输出采样率是 ADTS 头中的两倍）
+        int rate = frame->sample_rate;
+        range->next_sample = range->core_rate > 0 ? av_rescale(range->first_sample, rate, range->core_rate) : 0;
+        range->start_sample = llrint(range->start * rate);
+        range->end_sample = range->duration > 0 ? range->start_sample + llrint(range->duration * rate) : INT64_MAX;
+    }
+    int64_t first = range->next_sample;
+    range->next_sample += frame->nb_samples;
+    if (range->next_sample >= range->end_sample)
+        range->done = 1;
+
+    int64_t begin = range->start_sample - first;
+    int64_t end = range->end_sample - first;
+    if (begin < 0)
+        begin = 0;
+    if (end > frame->nb_samples)
+        end = frame->nb_samples;
+    if (end <= begin)
+        return 0;
+    if (trim_frame(frame, (int)begin, (int)end) < 0)
+    {
+        fprintf(stderr, "裁剪音频帧失败\n");
+        exit(1);
+    }
+    return 1;
+}
+
+// 把一帧按交错模式写入输出：整帧交错到临时缓冲区后一次写出，平面浮点格式使用 SIMD 交错
+static void write_interleaved(RawOutput *out, const AVFrame *frame, int data_size)
+{
+    static uint8_t *s_buf = NULL;
+    static size_t s_buf_size = 0;
+    const int channels = frame->ch_layout.nb_channels;
+    const size_t bytes = (size_t)frame->nb_samples * channels * data_size;
+    enum AVSampleFormat fmt = (enum AVSampleFormat)frame->format;
+
+    if (!av_sample_fmt_is_planar(fmt) || channels == 1)
+    {
+        raw_output_write(out, frame->extended_data[0], bytes);
+        return;
+    }
+    if (s_buf_size < bytes)
+    {
+        free(s_buf);
+        s_buf = (uint8_t *)malloc(bytes);
+        s_buf_size = s_buf ? bytes : 0;
+        if (!s_buf)
+        {
+            fprintf(stderr, "无法分配交错缓冲区\n");
+            exit(1);
+        }
+    }
+    if (fmt == AV_SAMPLE_FMT_FLTP)
+    {
+        interleave_f32_simd((const float *const *)frame->extended_data, channels, frame->nb_samples, (float *)s_buf);
+    }
+    else
+    {
+        uint8_t *dst = s_buf;
+        for (int i = 0; i < frame->nb_samples; i++)
+        {
+            for (int ch = 0; ch < channels; ch++)
+            {
+                memcpy(dst, frame->extended_data[ch] + data_size * i, data_size);
+                dst += data_size;
+            }
+        }
+    }
+    raw_output_write(out, s_buf, bytes);
+}
+
+// 解码函数，将音频包解码成音频帧并写入输出文件，同时累积波形概览
+static void decode(AVCodecContext *dec_ctx, AVPacket *pkt, AVFrame *frame, RawOutput *out, PeakBuilder *peaks,
+                   PcmCheckpoint *ckpt, PcmRange *range)
 {
-    int i, ch;
     int ret, data_size;
 
     // 发送包给解码器
@@ -65,6 +561,11 @@ static void decode(AVCodecContext *dec_ctx, AVPacket *pkt, AVFrame *frame, FILE
             fprintf(stderr, "计算数据大小失败\n");
             exit(1);
         }
+        // 预滚包的输出在断点之前已经写过
+        if (ckpt->preroll > 0)
+            continue;
+        if (!range_clip(range, frame))
+            continue;
         static int s_print_format = 0;
         if (s_print_format == 0)
         {
@@ -73,12 +574,41 @@ static void decode(AVCodecContext *dec_ctx, AVPacket *pkt, AVFrame *frame, FILE
         }
 
         // 写入交错模式的音频数据到输出文件
-        for (i = 0; i < frame->nb_samples; i++)
-        {
-            for (ch = 0; ch < dec_ctx->ch_layout.nb_channels; ch++)
-                fwrite(frame->data[ch] + data_size * i, 1, data_size, outfile);
-        }
+        write_interleaved(out, frame, data_size);
+
+        if (peaks->channels == 0)
+            peak_init(peaks, frame->ch_layout.nb_channels, frame->sample_rate);
+        peak_add_frame(peaks, frame);
+
+        ckpt->samples += frame->nb_samples;
+        ckpt->sample_fmt = dec_ctx->sample_fmt;
+        ckpt->channels = dec_ctx->ch_layout.nb_channels;
+        ckpt->sample_rate = frame->sample_rate;
+    }
+}
+
+// 把一段输入数据送进解析器，解析出完整的包后立即解码，返回解析器消耗的字节数
+static int parse_and_decode(AVCodecParserContext *parser, AVCodecContext *codec_ctx, AVPacket *pkt,
+                            const uint8_t *data, int size, AVFrame *frame, RawOutput *out, PeakBuilder *peaks,
+                            PcmCheckpoint *ckpt, PcmRange *range)
+{
+    int ret = av_parser_parse2(parser, codec_ctx, &pkt->data, &pkt->size, data, size, AV_NOPTS_VALUE, AV_NOPTS_VALUE, 0);
+    if (ret < 0)
+    {
+        fprintf(stderr, "解析时出错\n");
+        exit(1);
     }
+    if (pkt->size)
+    {
+        // frame_offset 是该包相对解析器收到的第一个字节的偏移
+        ckpt->packet_pos = ckpt->base_offset + parser->frame_offset;
+        decode(codec_ctx, pkt, frame, out, peaks, ckpt, range);
+        if (ckpt->preroll > 0)
+            ckpt->preroll--;
+        else
+            pcm_checkpoint_maybe(ckpt, out);
+    }
+    return ret;
 }
 
 int main(int argc, char **argv)
@@ -91,21 +621,83 @@ int main(int argc, char **argv)
     int len = 0;
     int ret = 0;
     FILE *infile = NULL;
-    FILE *outfile = NULL;
+    RawOutput outfile;
+    int direct_io = 0;
     uint8_t inbuf[AUDIO_INBUF_SIZE + AV_INPUT_BUFFER_PADDING_SIZE];
     uint8_t *data = NULL;
     size_t data_size = 0;
     AVPacket *pkt = NULL;
     AVFrame *decoded_frame = NULL;
+    MappedInput in_map;
+    PeakBuilder peaks;
+    char peaks_filename[1024];
+    PcmCheckpoint ckpt;
+    Checkpoint saved;
+    int resume = 0;
+    PcmRange range;
+    char cache_params[128] = "save_pcm";
 
     // 检查命令行参数
     if (argc <= 2)
     {
-        fprintf(stderr, "用法: %s <输入文件> <输出文件>\n", argv[0]);
+        fprintf(stderr, "用法: %s <输入文件> <输出文件> [--resume] [--start 秒] [--duration 秒] [--direct-io]\n", argv[0]);
         exit(0);
     }
     filename = argv[1];
     outfilename = argv[2];
+    memset(&range, 0, sizeof(range));
+    range.next_sample = -1;
+    for (int i = 3; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--resume") == 0)
+            resume = 1;
+        else if (strcmp(argv[i], "--direct-io") == 0)
+            direct_io = 1;
+        else if (strcmp(argv[i], "--start") == 0 && i + 1 < argc)
+        {
+            range.active = 1;
+            range.start = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc)
+        {
+            range.active = 1;
+            range.duration = atof(argv[++i]);
+        }
+        else
+        {
+            fprintf(stderr, "未知选项: %s\n", argv[i]);
+            exit(1);
+        }
+    }
+    if (range.start < 0 || range.duration < 0)
+    {
+        fprintf(stderr, "--start 和 --duration 不能为负数\n");
+        exit(1);
+    }
+    // 片段很短，不记录断点；参数不同的片段使用不同的缓存键
+    if (range.active && resume)
+    {
+        fprintf(stderr, "--resume 不能与 --start/--duration 一起使用\n");
+        exit(1);
+    }
+    if (range.active)
+        snprintf(cache_params, sizeof(cache_params), "save_pcm start=%.6f duration=%.6f", range.start, range.duration);
+    snprintf(peaks_filename, sizeof(peaks_filename), "%s.peaks", outfilename);
+    memset(&peaks, 0, sizeof(peaks));
+    memset(&ckpt, 0, sizeof(ckpt));
+    snprintf(ckpt.path, sizeof(ckpt.path), "%s.ckpt", outfilename);
+    ckpt.input_size = checkpoint_input_size(filename);
+    ckpt.enabled = ckpt.input_size >= 0 && !range.active;
+
+    // 同一输入已经解码过时直接从缓存复制 PCM 和波形概览
+    OutputCache cache;
+    const char *cache_roles[] = {"pcm", "peaks"};
+    const char *cache_outputs[] = {outfilename, peaks_filename};
+    if (cache_open(cache, filename, cache_params) && !resume && cache_fetch(cache, cache_roles, cache_outputs, 2))
+    {
+        printf("从缓存复制输出: %s\n", outfilename);
+        return 0;
+    }
 
     // 分配AVPacket
     pkt = av_packet_alloc();
@@ -122,6 +714,17 @@ int main(int argc, char **argv)
     {
         printf("默认编解码器ID:%d\n", audio_codec_id);
     }
+    // 断点只对 AAC 记录：重解码一个包就能补上 MDCT 重叠，
+    // MP3 的比特池（main_data_begin）可以回指前面几帧，从断点处解码的第一帧会缺数据
+    if (audio_codec_id != AV_CODEC_ID_AAC)
+    {
+        if (resume)
+        {
+            fprintf(stderr, "--resume 只支持 AAC 输入\n");
+            exit(1);
+        }
+        ckpt.enabled = 0;
+    }
 
     // 查找解码器
     codec = avcodec_find_decoder(audio_codec_id);
@@ -159,41 +762,108 @@ int main(int argc, char **argv)
         fprintf(stderr, "无法打开 %s\n", filename);
         exit(1);
     }
-    // 打开输出文件
-    outfile = fopen(outfilename, "wb");
-    if (!outfile)
+    // 恢复时确认断点属于同一个输入，把输出截断到断点，并从已有输出重建波形概览
+    if (resume && checkpoint_read(ckpt.path, &saved) != 0)
+    {
+        fprintf(stderr, "没有可用的断点，从头开始: %s\n", ckpt.path);
+        resume = 0;
+    }
+    if (resume)
     {
+        if (!ckpt.enabled || saved.input_size != ckpt.input_size || saved.input_pos < 0 ||
+            saved.input_pos >= saved.input_size)
+        {
+            fprintf(stderr, "断点与输入文件不匹配: %s\n", ckpt.path);
+            exit(1);
+        }
+        FILE *prev = NULL;
+        if (!raw_output_open(&outfile, outfilename, (int64_t)saved.output_bytes, direct_io) ||
+            !(prev = fopen(outfilename, "rb")) ||
+            peak_rebuild(&peaks, prev, saved.output_bytes, (enum AVSampleFormat)saved.param[0], saved.param[1],
+                         saved.param[2]) < 0)
+        {
+            fprintf(stderr, "无法从断点恢复输出文件 %s\n", outfilename);
+            exit(1);
+        }
+        fclose(prev);
+        ckpt.base_offset = saved.input_pos;
+        ckpt.preroll = 1;
+        ckpt.samples = saved.units;
+        ckpt.sample_fmt = saved.param[0];
+        ckpt.channels = saved.param[1];
+        ckpt.sample_rate = saved.param[2];
+        printf("从第 %llu 个采样 (输入偏移 %lld) 继续\n", (unsigned long long)saved.units, (long long)saved.input_pos);
+    }
+    else if (!raw_output_open(&outfile, outfilename, -1, direct_io)) // 打开输出文件
+    {
+        fprintf(stderr, "无法打开输出文件 %s\n", outfilename);
         av_free(codec_ctx);
         exit(1);
     }
+    ckpt.last_write = av_gettime_relative();
 
-    // 读取文件数据
-    data = inbuf;
-    data_size = fread(inbuf, 1, AUDIO_INBUF_SIZE, infile);
+    if (!(decoded_frame = av_frame_alloc()))
+    {
+        fprintf(stderr, "无法分配音频帧\n");
+        exit(1);
+    }
 
-    while (data_size > 0)
+    // 优先把输入文件映射到内存，映射区直接交给解析器，不再经过 inbuf 拷贝和补充
+    if (map_input(filename, in_map) == 0)
     {
-        if (!decoded_frame)
+        // AAC 片段：跳到包含起点的帧之前，不解析前面的输入
+        if (range.active && range.start > 0 && audio_codec_id == AV_CODEC_ID_AAC)
         {
-            if (!(decoded_frame = av_frame_alloc()))
+            int found = adts_find_start(in_map.data, in_map.size, &range, &ckpt.base_offset, &ckpt.preroll);
+            if (found == -2)
             {
-                fprintf(stderr, "无法分配音频帧\n");
+                fprintf(stderr, "起始时间超出输入长度\n");
                 exit(1);
             }
+            if (found == 0)
+                printf("从输入偏移 %lld 开始解码 (采样 %lld, 预滚 %d 包)\n", (long long)ckpt.base_offset,
+                       (long long)range.first_sample, ckpt.preroll);
         }
+        const uint8_t *map_data = in_map.data + ckpt.base_offset;
+        size_t map_left = in_map.size - ckpt.base_offset;
 
-        ret = av_parser_parse2(parser, codec_ctx, &pkt->data, &pkt->size, data, data_size, AV_NOPTS_VALUE, AV_NOPTS_VALUE, 0);
-        if (ret < 0)
+        // 解码器可能读到包末尾之后 AV_INPUT_BUFFER_PADDING_SIZE 字节，映射区末尾留给下面的补零缓冲区处理
+        while (map_left > AV_INPUT_BUFFER_PADDING_SIZE && !range.done)
         {
-            fprintf(stderr, "解析时出错\n");
-            exit(1);
+            size_t chunk = map_left - AV_INPUT_BUFFER_PADDING_SIZE;
+            if (chunk > AUDIO_MAP_CHUNK)
+                chunk = AUDIO_MAP_CHUNK;
+            advise_input_window(in_map, map_data - in_map.data);
+            ret = parse_and_decode(parser, codec_ctx, pkt, map_data, (int)chunk, decoded_frame, &outfile, &peaks,
+                                   &ckpt, &range);
+            map_data += ret;
+            map_left -= ret;
         }
+
+        if (range.done)
+            map_left = 0; // 片段已经输出完，剩余输入不再解析
+        memcpy(inbuf, map_data, map_left);
+        data = inbuf;
+        data_size = map_left;
+        fseek(infile, 0, SEEK_END); // 剩余部分已拷贝，后面的 fread 只会读到文件末尾
+    }
+    else
+    {
+        // 管道等无法映射的输入，按原来的方式分块读取
+        if (ckpt.base_offset > 0)
+            fseeko(infile, ckpt.base_offset, SEEK_SET);
+        data = inbuf;
+        data_size = fread(inbuf, 1, AUDIO_INBUF_SIZE, infile);
+    }
+
+    while (data_size > 0 && !range.done)
+    {
+        memset(inbuf + (data - inbuf) + data_size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+        ret = parse_and_decode(parser, codec_ctx, pkt, data, data_size, decoded_frame, &outfile, &peaks, &ckpt,
+                               &range);
         data += ret;
         data_size -= ret;
 
-        if (pkt->size)
-            decode(codec_ctx, pkt, decoded_frame, outfile);
-
         if (data_size < AUDIO_REFILL_THRESH)
         {
             memmove(inbuf, data, data_size);
@@ -207,11 +877,23 @@ int main(int argc, char **argv)
     // 冲刷解码器
     pkt->data = NULL;
     pkt->size = 0;
-    decode(codec_ctx, pkt, decoded_frame, outfile);
+    decode(codec_ctx, pkt, decoded_frame, &outfile, &peaks, &ckpt, &range);
+
+    // 写出波形概览
+    int peaks_ok = peaks.channels > 0 && peak_write(&peaks, peaks_filename) == 0;
+    peak_free(&peaks);
 
-    // 关闭文件
-    fclose(outfile);
+    // 关闭文件，整个输入都已解码，断点不再需要，完整的输出存入缓存
+    if (!raw_output_close(&outfile))
+    {
+        fprintf(stderr, "写入输出文件失败: %s\n", outfilename);
+        exit(1);
+    }
+    unlink(ckpt.path);
+    if (peaks_ok)
+        cache_store(cache, cache_roles, cache_outputs, 2);
     fclose(infile);
+    unmap_input(in_map);
 
     // 释放资源
     avcodec_free_context(&codec_ctx);
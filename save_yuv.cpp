@@ -2,6 +2,7 @@ extern "C" {
     #include <libavformat/avformat.h>
     #include <libavcodec/avcodec.h>
     #include <libavutil/imgutils.h>
+    #include <libavutil/time.h>
     #include <libswscale/swscale.h>
 }
 
@@ -9,6 +10,12 @@ extern "C" {
 #include <fstream>
 #include <string>
 
+#include "input_io.h"
+#include "checkpoint.h"
+#include "output_cache.h"
+#include "raw_output.h"
+#include "simd_kernels.h"
+
 // 获取文件路径的父目录
 std::string getParentDirectory(const std::string &filePath) {
     size_t pos = filePath.find_last_of("/\\");
@@ -16,22 +23,132 @@ std::string getParentDirectory(const std::string &filePath) {
 }
 
 // 保存YUV帧数据到文件
-void SaveFrame(AVFrame *pFrame, int width, int height, FILE *pFile) {
+void SaveFrame(AVFrame *pFrame, int width, int height, RawOutput *out) {
     int y;
 
     // 写入Y平面数据
     for (y = 0; y < height; y++)
-        fwrite(pFrame->data[0] + y * pFrame->linesize[0], 1, width, pFile);
+        raw_output_write(out, pFrame->data[0] + y * pFrame->linesize[0], width);
     // 写入U平面数据
     for (y = 0; y < height / 2; y++)
-        fwrite(pFrame->data[1] + y * pFrame->linesize[1], 1, width / 2, pFile);
+        raw_output_write(out, pFrame->data[1] + y * pFrame->linesize[1], width / 2);
     // 写入V平面数据
     for (y = 0; y < height / 2; y++)
-        fwrite(pFrame->data[2] + y * pFrame->linesize[2], 1, width / 2, pFile);
+        raw_output_write(out, pFrame->data[2] + y * pFrame->linesize[2], width / 2);
+}
+
+// 是否为关键帧，断点只设在关键帧上，恢复时 seek 到这里最多重做一个GOP
+static bool IsKeyFrame(const AVFrame *pFrame) {
+#ifdef AV_FRAME_FLAG_KEY
+    return (pFrame->flags & AV_FRAME_FLAG_KEY) != 0;
+#else
+    return pFrame->key_frame != 0;
+#endif
+}
+
+/*
+ * 去重模式：与上一个写出的帧完全相同的帧不写入输出，时间信息写到 <输出>.timestamps，
+ * 每行为 "帧序号 pts_ms duration_ms"，重复帧的时长累加到它之前写出的那一帧上。
+ */
+struct DedupState {
+    bool enabled = false;
+    FILE *timestamps = nullptr;
+    AVFrame *prev = nullptr;        // 上一个写出的帧（引用解码器的缓冲区，不拷贝）
+    uint64_t prevHash = 0;
+    bool pending = false;           // 上一个写出的帧还没有写入时间戳（时长要等下一个不同的帧）
+    uint64_t pendingIndex = 0;
+    int64_t pendingPts = 0;
+    int64_t lastPts = AV_NOPTS_VALUE; // 最后一个解码帧的 PTS
+    int64_t frameDuration = 1;      // 按帧率估计的单帧时长，用于最后一帧和没有 PTS 的帧
+    AVRational timeBase = {1, 1000};
+    uint64_t decoded = 0;
+    uint64_t skipped = 0;
+    uint64_t collisions = 0;        // 哈希相同但内容不同
+    int64_t hashUs = 0;             // 哈希和比较的总耗时
+};
+
+// 依次哈希 Y、U、V 三个平面
+static uint64_t HashFrame(const AVFrame *pFrame, int width, int height) {
+    uint64_t h = frame_hash_plane(pFrame->data[0], pFrame->linesize[0], width, height, 0);
+    h = frame_hash_plane(pFrame->data[1], pFrame->linesize[1], width / 2, height / 2, h);
+    return frame_hash_plane(pFrame->data[2], pFrame->linesize[2], width / 2, height / 2, h);
+}
+
+// 哈希相同时逐行比较实际写出的像素
+static bool SameFrame(const AVFrame *a, const AVFrame *b, int width, int height) {
+    for (int plane = 0; plane < 3; plane++) {
+        const int w = plane ? width / 2 : width, h = plane ? height / 2 : height;
+        for (int y = 0; y < h; y++) {
+            if (memcmp(a->data[plane] + (size_t)y * a->linesize[plane],
+                       b->data[plane] + (size_t)y * b->linesize[plane], w) != 0)
+                return false;
+        }
+    }
+    return true;
+}
+
+// 写出上一个写出帧的时间戳，它的时长持续到 endPts
+static void DedupWritePending(DedupState &dedup, int64_t endPts) {
+    if (!dedup.pending)
+        return;
+    const double ms = av_q2d(dedup.timeBase) * 1000.0;
+    fprintf(dedup.timestamps, "%llu %.3f %.3f\n", (unsigned long long)dedup.pendingIndex, dedup.pendingPts * ms,
+            (endPts - dedup.pendingPts) * ms);
+    dedup.pending = false;
 }
 
-// 处理MP4文件并保存为YUV格式
-void ProcessMP4ToYUV(const std::string &inputFile) {
+// 处理一个解码帧，返回 true 表示与上一个写出的帧相同，应当跳过
+static bool DedupFrame(DedupState &dedup, AVFrame *pFrame, int width, int height, uint64_t framesWritten) {
+    int64_t pts = pFrame->best_effort_timestamp;
+    if (pts == AV_NOPTS_VALUE)
+        pts = dedup.lastPts == AV_NOPTS_VALUE ? 0 : dedup.lastPts + dedup.frameDuration;
+    dedup.lastPts = pts;
+    dedup.decoded++;
+
+    const int64_t start = av_gettime_relative();
+    const uint64_t hash = HashFrame(pFrame, width, height);
+    bool duplicate = false;
+    if (dedup.prev->data[0] && hash == dedup.prevHash) {
+        duplicate = SameFrame(dedup.prev, pFrame, width, height);
+        if (!duplicate)
+            dedup.collisions++;
+    }
+    dedup.hashUs += av_gettime_relative() - start;
+    if (duplicate) {
+        dedup.skipped++;
+        return true;
+    }
+
+    DedupWritePending(dedup, pts);
+    dedup.pending = true;
+    dedup.pendingIndex = framesWritten;
+    dedup.pendingPts = pts;
+    av_frame_unref(dedup.prev);
+    av_frame_ref(dedup.prev, pFrame);
+    dedup.prevHash = hash;
+    return false;
+}
+
+// 写出最后一帧的时间戳并输出去重的效果和开销
+static void DedupFinish(DedupState &dedup, uint64_t frameSize, int64_t totalUs) {
+    if (dedup.lastPts != AV_NOPTS_VALUE)
+        DedupWritePending(dedup, dedup.lastPts + dedup.frameDuration);
+    const uint64_t written = dedup.decoded - dedup.skipped;
+    const double mb = 1.0 / (1024 * 1024);
+    std::cout << "去重: 解码 " << dedup.decoded << " 帧, 写出 " << written << " 帧, 跳过 " << dedup.skipped
+              << " 帧 (哈希相同但内容不同 " << dedup.collisions << " 次)" << std::endl;
+    if (dedup.decoded > 0) {
+        printf("输出 %.1f MB, 不去重时 %.1f MB, 减少 %.1f%%\n", written * frameSize * mb,
+               dedup.decoded * frameSize * mb, 100.0 * dedup.skipped / dedup.decoded);
+        printf("哈希和比较耗时 %.1f ms (每帧 %.1f us, 占总耗时 %.1f%%)\n", dedup.hashUs / 1000.0,
+               (double)dedup.hashUs / dedup.decoded, totalUs > 0 ? 100.0 * dedup.hashUs / totalUs : 0.0);
+    }
+}
+
+// 处理MP4文件并保存为YUV格式，resume 为真时从上次的断点继续，directIo 为真时输出绕过页缓存，
+// dedup 为真时跳过重复帧并写出时间戳文件
+void ProcessMP4ToYUV(const std::string &inputFile, const InputOptions &inputOpts, bool resume, bool directIo,
+                     bool dedup) {
     AVFormatContext *pFormatCtx = nullptr;
     int videoStream;
     AVCodecContext *pCodecCtx = nullptr;
@@ -42,24 +159,60 @@ void ProcessMP4ToYUV(const std::string &inputFile) {
     // 获取输出目录和输出文件路径
     std::string outputDir = getParentDirectory(inputFile);
     std::string outputFilePath = outputDir + "/sample.yuv";
-    FILE *pFile = fopen(outputFilePath.c_str(), "wb");
-    if (pFile == nullptr) {
+    std::string ckptPath = outputFilePath + ".ckpt";
+    std::string timestampsPath = outputFilePath + ".timestamps";
+
+    // 输入仍在写入时每帧都刷新输出，让下游只落后写入方有限的时间；这种输入不能 seek，也不设断点
+    const bool live = input_is_live(inputFile.c_str(), inputOpts);
+    const int64_t inputSize = checkpoint_input_size(inputFile.c_str());
+
+    // 同一输入已经解码过时直接从缓存复制输出，去重模式还包括时间戳文件
+    OutputCache cache;
+    const char *cacheRoles[] = {"yuv", "timestamps"};
+    const char *cacheOutputs[] = {outputFilePath.c_str(), timestampsPath.c_str()};
+    const int cacheFiles = dedup ? 2 : 1;
+    if (!live && cache_open(cache, inputFile.c_str(), dedup ? "save_yuv --dedup" : "save_yuv") && !resume &&
+        cache_fetch(cache, cacheRoles, cacheOutputs, cacheFiles)) {
+        std::cout << "从缓存复制输出: " << outputFilePath << std::endl;
+        return;
+    }
+
+    // 恢复时先确认断点属于同一个输入，再把输出截断到断点关键帧之前
+    Checkpoint ckpt;
+    bool resuming = false;
+    if (resume) {
+        if (live) {
+            std::cerr << "跟随模式和管道输入不支持 --resume" << std::endl;
+            return;
+        }
+        if (checkpoint_read(ckptPath.c_str(), &ckpt) != 0) {
+            std::cerr << "没有可用的断点，从头开始: " << ckptPath << std::endl;
+        } else if (ckpt.input_size != inputSize) {
+            std::cerr << "断点与输入文件不匹配: " << ckptPath << std::endl;
+            return;
+        } else {
+            resuming = true;
+        }
+    }
+
+    RawOutput out;
+    if (!raw_output_open(&out, outputFilePath.c_str(), resuming ? (int64_t)ckpt.output_bytes : -1, directIo)) {
         std::cerr << "无法打开输出文件: " << outputFilePath << std::endl;
         return;
     }
 
     // 打开输入文件
-    if (avformat_open_input(&pFormatCtx, inputFile.c_str(), nullptr, nullptr) != 0) {
+    if (open_input_file(&pFormatCtx, inputFile.c_str(), inputOpts) != 0) {
         std::cerr << "无法打开输入文件: " << inputFile << std::endl;
-        fclose(pFile);
+        raw_output_close(&out);
         return;
     }
 
     // 获取流信息
     if (avformat_find_stream_info(pFormatCtx, nullptr) < 0) {
         std::cerr << "无法找到流信息" << std::endl;
-        fclose(pFile);
-        avformat_close_input(&pFormatCtx);
+        raw_output_close(&out);
+        close_input_file(&pFormatCtx);
         return;
     }
 
@@ -76,8 +229,8 @@ void ProcessMP4ToYUV(const std::string &inputFile) {
     }
     if (videoStream == -1) {
         std::cerr << "未找到视频流" << std::endl;
-        fclose(pFile);
-        avformat_close_input(&pFormatCtx);
+        raw_output_close(&out);
+        close_input_file(&pFormatCtx);
         return;
     }
 
@@ -85,8 +238,8 @@ void ProcessMP4ToYUV(const std::string &inputFile) {
     pCodec = avcodec_find_decoder(pFormatCtx->streams[videoStream]->codecpar->codec_id);
     if (pCodec == nullptr) {
         std::cerr << "不支持的编解码器!" << std::endl;
-        fclose(pFile);
-        avformat_close_input(&pFormatCtx);
+        raw_output_close(&out);
+        close_input_file(&pFormatCtx);
         return;
     }
 
@@ -94,18 +247,18 @@ void ProcessMP4ToYUV(const std::string &inputFile) {
     pCodecCtx = avcodec_alloc_context3(pCodec);
     if (avcodec_parameters_to_context(pCodecCtx, pFormatCtx->streams[videoStream]->codecpar) < 0) {
         std::cerr << "无法复制编解码器上下文" << std::endl;
-        fclose(pFile);
+        raw_output_close(&out);
         avcodec_free_context(&pCodecCtx);
-        avformat_close_input(&pFormatCtx);
+        close_input_file(&pFormatCtx);
         return;
     }
 
     // 打开编解码器
     if (avcodec_open2(pCodecCtx, pCodec, nullptr) < 0) {
         std::cerr << "无法打开编解码器" << std::endl;
-        fclose(pFile);
+        raw_output_close(&out);
         avcodec_free_context(&pCodecCtx);
-        avformat_close_input(&pFormatCtx);
+        close_input_file(&pFormatCtx);
         return;
     }
 
@@ -113,42 +266,144 @@ void ProcessMP4ToYUV(const std::string &inputFile) {
     pFrame = av_frame_alloc();
     if (pFrame == nullptr) {
         std::cerr << "无法分配AVFrame" << std::endl;
-        fclose(pFile);
+        raw_output_close(&out);
         avcodec_free_context(&pCodecCtx);
-        avformat_close_input(&pFormatCtx);
+        close_input_file(&pFormatCtx);
         return;
     }
 
+    const int width = pCodecCtx->width, height = pCodecCtx->height;
+    const uint64_t frameSize = (uint64_t)width * height + 2 * (uint64_t)(width / 2) * (height / 2);
+    uint64_t framesWritten = 0;
+    int64_t resumePts = AV_NOPTS_VALUE;
+
+    DedupState dedupState;
+    if (dedup) {
+        dedupState.timestamps = fopen(timestampsPath.c_str(), "w");
+        dedupState.prev = av_frame_alloc();
+        if (!dedupState.timestamps || !dedupState.prev) {
+            std::cerr << "无法打开时间戳文件: " << timestampsPath << std::endl;
+            if (dedupState.timestamps)
+                fclose(dedupState.timestamps);
+            av_frame_free(&dedupState.prev);
+            raw_output_close(&out);
+            av_frame_free(&pFrame);
+            avcodec_free_context(&pCodecCtx);
+            close_input_file(&pFormatCtx);
+            return;
+        }
+        AVStream *stream = pFormatCtx->streams[videoStream];
+        AVRational frameRate = av_guess_frame_rate(pFormatCtx, stream, nullptr);
+        dedupState.enabled = true;
+        dedupState.timeBase = stream->time_base;
+        if (frameRate.num > 0 && frameRate.den > 0)
+            dedupState.frameDuration = std::max<int64_t>(1, av_rescale_q(1, av_inv_q(frameRate), stream->time_base));
+        fprintf(dedupState.timestamps, "# frame pts_ms duration_ms\n");
+    }
+
+    // 从断点关键帧之前最近的关键帧开始解码，PTS 早于断点的帧已经在输出里，解码后丢弃
+    if (resuming) {
+        if (ckpt.param[0] != width || ckpt.param[1] != height ||
+            av_seek_frame(pFormatCtx, videoStream, ckpt.input_pos, AVSEEK_FLAG_BACKWARD) < 0) {
+            std::cerr << "无法恢复到断点: " << ckptPath << std::endl;
+            raw_output_close(&out);
+            av_frame_free(&pFrame);
+            avcodec_free_context(&pCodecCtx);
+            close_input_file(&pFormatCtx);
+            return;
+        }
+        resumePts = ckpt.input_pos;
+        framesWritten = ckpt.units;
+        std::cout << "从第 " << framesWritten << " 帧 (pts " << resumePts << ") 继续" << std::endl;
+    }
+
     // 读取帧数据并解码
-    while (av_read_frame(pFormatCtx, &packet) >= 0) {
+    const int64_t startUs = av_gettime_relative();
+    int readRet;
+    while ((readRet = av_read_frame(pFormatCtx, &packet)) >= 0) {
         if (packet.stream_index == videoStream) {
             if (avcodec_send_packet(pCodecCtx, &packet) != 0) {
                 av_packet_unref(&packet);
                 continue;
             }
             while (avcodec_receive_frame(pCodecCtx, pFrame) == 0) {
-                SaveFrame(pFrame, pCodecCtx->width, pCodecCtx->height, pFile);
+                const int64_t pts = pFrame->best_effort_timestamp;
+                if (resumePts != AV_NOPTS_VALUE && pts != AV_NOPTS_VALUE && pts < resumePts)
+                    continue;
+
+                if (dedupState.enabled && DedupFrame(dedupState, pFrame, width, height, framesWritten))
+                    continue;
+
+                // 每个关键帧写入之前记录断点：之前的帧都已刷新到输出文件；去重模式不记录断点
+                if (!live && !dedupState.enabled && pts != AV_NOPTS_VALUE && IsKeyFrame(pFrame)) {
+                    raw_output_flush(&out);
+                    Checkpoint cur = {pts, framesWritten * frameSize, framesWritten, inputSize, {width, height, 0}};
+                    checkpoint_write(ckptPath.c_str(), &cur);
+                }
+
+                SaveFrame(pFrame, width, height, &out);
+                framesWritten++;
+                if (live) {
+                    raw_output_flush(&out);
+                    if (dedupState.enabled)
+                        fflush(dedupState.timestamps);
+                }
             }
         }
         av_packet_unref(&packet);
     }
 
+    // 正常读到末尾后断点不再需要，完整的输出存入缓存
+    bool written = raw_output_close(&out);
+    if (dedupState.enabled) {
+        DedupFinish(dedupState, frameSize, av_gettime_relative() - startUs);
+        written = fclose(dedupState.timestamps) == 0 && written;
+        av_frame_free(&dedupState.prev);
+    }
+    if (!written)
+        std::cerr << "写入输出文件失败: " << outputFilePath << std::endl;
+    if (readRet == AVERROR_EOF && written) {
+        unlink(ckptPath.c_str());
+        cache_store(cache, cacheRoles, cacheOutputs, cacheFiles);
+    }
+
     // 释放资源
-    fclose(pFile);
     av_frame_free(&pFrame);
     avcodec_free_context(&pCodecCtx);
-    avformat_close_input(&pFormatCtx);
+    close_input_file(&pFormatCtx);
 }
 
 // 主函数，处理命令行参数并调用处理函数
 int main(int argc, char *argv[]) {
     if (argc < 2) {
-        std::cerr << "用法: " << argv[0] << " <输入文件>" << std::endl;
+        std::cerr << "用法: " << argv[0] << " <输入文件|-> " << input_options_usage() << " [--resume] [--direct-io] [--dedup]" << std::endl;
+        return -1;
+    }
+
+    InputOptions inputOpts;
+    bool resume = false;
+    bool directIo = false;
+    bool dedup = false;
+    for (int i = 2; i < argc; i++) {
+        if (std::string(argv[i]) == "--resume") {
+            resume = true;
+        } else if (std::string(argv[i]) == "--direct-io") {
+            directIo = true;
+        } else if (std::string(argv[i]) == "--dedup") {
+            dedup = true;
+        } else if (!parse_input_option(argc, argv, i, inputOpts)) {
+            std::cerr << "未知选项: " << argv[i] << std::endl;
+            return -1;
+        }
+    }
+
+    if (dedup && resume) {
+        std::cerr << "--dedup 不能与 --resume 一起使用" << std::endl;
         return -1;
     }
 
     std::string inputFile = argv[1];
-    ProcessMP4ToYUV(inputFile);
+    ProcessMP4ToYUV(inputFile, inputOpts, resume, directIo, dedup);
 
     return 0;
 }
@@ -1,41 +1,165 @@
 #include <SDL2/SDL.h>
 #include <iostream>
 #include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include "headless_bench.h"
+#include "simd_kernels.h"
 
 #define SAMPLE_RATE 44100
 #define NUM_CHANNELS 2
 #define SAMPLE_FORMAT AUDIO_S16SYS
 #define BUFFER_SIZE 4096
 
-// 音频回调函数，将音频数据从文件读取到音频缓冲区中
-void audio_callback(void* userdata, Uint8* stream, int len) {
-    std::ifstream* audioFile = static_cast<std::ifstream*>(userdata);
-    if (!audioFile->read(reinterpret_cast<char*>(stream), len)) {
-        // 如果文件读取的数据少于 len，用静音数据填充剩余部分
-        std::fill(stream + audioFile->gcount(), stream + len, 0);
+// 每路的预读环形缓冲区（约1.5秒），读线程每次最多读入 TRACK_READ_CHUNK 字节
+#define TRACK_RING_SIZE (1 << 18)
+#define TRACK_READ_CHUNK 16384
+#define MAX_TRACKS 64
+
+// 路数扫描的每一步按实时节奏运行的回调次数（约6秒）
+#define SWEEP_CALLBACKS 64
+
+// 一路输入：读线程把文件预读到环形缓冲区，回调只从缓冲区混音，不在回调里读文件
+struct Track {
+    std::ifstream file;
+    int16_t gain_q14 = 1 << 14;             // Q14 增益，1<<14 为原始音量
+    std::vector<uint8_t> ring;
+    std::atomic<uint64_t> head{0};          // 读线程写入的总字节数，只由读线程修改
+    std::atomic<uint64_t> tail{0};          // 回调消费的总字节数，只由回调修改
+    std::atomic<bool> eof{false};
+    std::thread reader;
+};
+
+// 命令行给出的一路输入；路数扫描时按顺序循环复制这些输入
+struct TrackInput {
+    std::string path;
+    int16_t gain_q14;
+};
+
+static std::vector<TrackInput> g_inputs;
+static std::vector<std::unique_ptr<Track>> g_tracks;
+static std::atomic<bool> g_stop(false);
+static std::atomic<uint64_t> g_underruns(0);   // 某一路缓冲区没有足够数据的次数
+
+// 大于0时为无头基准模式：不限速地执行这么多次回调（或所有输入播放完）后退出
+static int g_bench_callbacks = 0;
+static AudioBenchStats g_bench_stats;
+static std::atomic<bool> g_bench_done(false);
+
+// 读线程：单生产者，缓冲区有空间时读入文件，读到末尾后退出
+static void track_reader(Track* t) {
+    while (!g_stop) {
+        uint64_t head = t->head.load(std::memory_order_relaxed);
+        uint64_t tail = t->tail.load(std::memory_order_acquire);
+        if (TRACK_RING_SIZE - (head - tail) < TRACK_READ_CHUNK) {
+            SDL_Delay(2);
+            continue;
+        }
+        size_t pos = head & (TRACK_RING_SIZE - 1);
+        size_t n = TRACK_READ_CHUNK;
+        if (n > TRACK_RING_SIZE - pos)
+            n = TRACK_RING_SIZE - pos;
+        t->file.read(reinterpret_cast<char*>(t->ring.data() + pos), n);
+        size_t got = t->file.gcount();
+        t->head.store(head + got, std::memory_order_release);
+        if (got < n) {
+            t->eof.store(true, std::memory_order_release);
+            return;
+        }
     }
 }
 
-int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        std::cerr << "用法: " << argv[0] << " <输入PCM文件>\n";
-        return -1;
+// 音频回调函数：把各路缓冲区中的数据按增益饱和混音到设备缓冲区
+void audio_callback(void* userdata, Uint8* stream, int len) {
+    Uint64 t0 = SDL_GetPerformanceCounter();
+    std::vector<std::unique_ptr<Track>>& tracks = *static_cast<std::vector<std::unique_ptr<Track>>*>(userdata);
+    int16_t* out = reinterpret_cast<int16_t*>(stream);
+    memset(stream, 0, len);
+
+    bool all_done = true;
+    for (size_t i = 0; i < tracks.size(); i++) {
+        Track* t = tracks[i].get();
+        // 先读 eof 再读 head：eof 为真时 head 已经是最终值
+        bool eof = t->eof.load(std::memory_order_acquire);
+        uint64_t head = t->head.load(std::memory_order_acquire);
+        uint64_t tail = t->tail.load(std::memory_order_relaxed);
+        size_t n = (size_t)(head - tail) & ~(size_t)1;
+        if (n > (size_t)len)
+            n = len;
+
+        // 环形缓冲区回绕时分两段混音
+        size_t pos = tail & (TRACK_RING_SIZE - 1);
+        size_t first = n < TRACK_RING_SIZE - pos ? n : TRACK_RING_SIZE - pos;
+        mix_s16_simd(out, reinterpret_cast<const int16_t*>(t->ring.data() + pos), (int)(first / 2), t->gain_q14);
+        if (n > first)
+            mix_s16_simd(out + first / 2, reinterpret_cast<const int16_t*>(t->ring.data()), (int)((n - first) / 2),
+                         t->gain_q14);
+        t->tail.store(tail + n, std::memory_order_release);
+
+        // 基准模式达到回调次数后设备关闭前的回调不计入
+        if (n < (size_t)len && !eof && !g_bench_done)
+            g_underruns.fetch_add(1, std::memory_order_relaxed);
+        if (!eof || head - (tail + n) >= 2)
+            all_done = false;
     }
 
-    const char* input_filename = argv[1];
-    // 打开输入的PCM文件
-    std::ifstream audioFile(input_filename, std::ios::binary);
-    if (!audioFile.is_open()) {
-        std::cerr << "无法打开文件: " << input_filename << "\n";
-        return -1;
+    if (g_bench_callbacks > 0 && !g_bench_done) {
+        stage_record(g_bench_stats.callback, t0);
+        g_bench_stats.callbacks++;
+        g_bench_stats.bytes += len;
+        if (all_done || g_bench_stats.callbacks >= (Uint64)g_bench_callbacks)
+            g_bench_done = true;
     }
+}
 
-    // 初始化SDL音频子系统
-    if (SDL_Init(SDL_INIT_AUDIO) < 0) {
-        std::cerr << "无法初始化SDL - " << SDL_GetError() << "\n";
-        return -1;
+// 按输入循环打开 count 路并启动读线程，先预读再开始播放
+static bool open_tracks(size_t count) {
+    g_stop = false;
+    for (size_t i = 0; i < count; i++) {
+        const TrackInput& in = g_inputs[i % g_inputs.size()];
+        std::unique_ptr<Track> t(new Track);
+        // 打开输入的PCM文件
+        t->file.open(in.path.c_str(), std::ios::binary);
+        if (!t->file.is_open()) {
+            std::cerr << "无法打开文件: " << in.path << "\n";
+            return false;
+        }
+        t->gain_q14 = in.gain_q14;
+        t->ring.resize(TRACK_RING_SIZE);
+        g_tracks.push_back(std::move(t));
     }
+    for (size_t i = 0; i < g_tracks.size(); i++)
+        g_tracks[i]->reader = std::thread(track_reader, g_tracks[i].get());
+    // 等每一路至少预读一个回调缓冲区（或已读完），第一次回调不会因为读线程还没启动而欠载
+    const uint64_t first = BUFFER_SIZE * NUM_CHANNELS * 2;
+    for (size_t i = 0; i < g_tracks.size(); i++) {
+        Track* t = g_tracks[i].get();
+        while (t->head.load(std::memory_order_acquire) < first && !t->eof.load(std::memory_order_acquire))
+            SDL_Delay(1);
+    }
+    return true;
+}
 
+// 停止读线程并关闭音频文件
+static void close_tracks() {
+    g_stop = true;
+    for (size_t i = 0; i < g_tracks.size(); i++) {
+        if (g_tracks[i]->reader.joinable())
+            g_tracks[i]->reader.join();
+        g_tracks[i]->file.close();
+    }
+    g_tracks.clear();
+}
+
+// 打开音频设备，播放当前的各路输入：基准模式下等待回调次数达到 callbacks，否则等待用户按 Enter
+static bool play_tracks(int callbacks) {
     SDL_AudioSpec wanted_spec;
     SDL_zero(wanted_spec); // 将wanted_spec结构体初始化为0
     wanted_spec.freq = SAMPLE_RATE; // 采样率
@@ -44,22 +168,145 @@ int main(int argc, char* argv[]) {
     wanted_spec.silence = 0; // 静音值
     wanted_spec.samples = BUFFER_SIZE; // 音频缓冲区大小
     wanted_spec.callback = audio_callback; // 回调函数
-    wanted_spec.userdata = &audioFile; // 传递给回调函数的用户数据
+    wanted_spec.userdata = &g_tracks; // 传递给回调函数的用户数据
+
+    g_underruns = 0;
+    g_bench_stats = AudioBenchStats();
+    g_bench_done = false;
+    g_bench_callbacks = callbacks;
 
     // 打开音频设备并开始播放
     if (SDL_OpenAudio(&wanted_spec, NULL) < 0) {
         std::cerr << "SDL_OpenAudio错误: " << SDL_GetError() << "\n";
-        return -1;
+        return false;
     }
 
+    g_bench_stats.start = SDL_GetPerformanceCounter();
     SDL_PauseAudio(0); // 开始播放音频
 
-    std::cout << "正在播放音频，请按 Enter 退出...\n";
-    std::cin.get(); // 等待用户按下Enter键
+    if (callbacks > 0) {
+        // 等待回调次数达到要求或所有输入播放完
+        while (!g_bench_done)
+            SDL_Delay(1);
+    } else {
+        std::cout << "正在播放 " << g_tracks.size() << " 路音频，请按 Enter 退出...\n";
+        std::cin.get(); // 等待用户按下Enter键
+    }
 
     SDL_CloseAudio(); // 关闭音频设备
-    SDL_Quit(); // 清理所有初始化的SDL子系统
-    audioFile.close(); // 关闭音频文件
+    return true;
+}
+
+// 一个回调缓冲区对应的播放时长
+static double buffer_period_ms() {
+    return 1000.0 * BUFFER_SIZE / SAMPLE_RATE;
+}
+
+// 按不限速运行的单路混音耗时推算路数上限：缓冲区时长除以单路耗时，
+// 忽略了读线程和调度的开销，只作为实测结果的参考
+static void print_mix_estimate(const AudioBenchStats& stats, size_t num_tracks) {
+    if (stats.callback.count == 0 || num_tracks == 0)
+        return;
+    const double ms = 1000.0 / SDL_GetPerformanceFrequency();
+    double per_track_ms = stats.callback.total * ms / stats.callback.count / num_tracks;
+    printf("按 %zu 路时每路每次回调 %.4f ms 推算，上限约 %.0f 路（估计值，非实测）\n", num_tracks, per_track_ms,
+           per_track_ms > 0 ? buffer_period_ms() / per_track_ms : 0.0);
+}
+
+// 实测路数上限：按 1、2、4… 路复制输入，每一步用 disk 驱动按实时节奏运行 SWEEP_CALLBACKS 次回调，
+// 出现欠载或单次回调耗时超过缓冲区时长时停止，报告第一个失败的路数
+static void run_mix_sweep(bool keep_delay) {
+    // disk 驱动每次回调后等待这么久，回调按实时节奏到来；启动前已经通过环境变量指定的延迟不覆盖
+    if (!keep_delay) {
+        char delay[16];
+        snprintf(delay, sizeof(delay), "%d", (int)(buffer_period_ms() + 0.5));
+        SDL_setenv("SDL_DISKAUDIODELAY", delay, 1);
+    }
+
+    const double ms = 1000.0 / SDL_GetPerformanceFrequency();
+    size_t passed = 0, failed = 0;
+    printf("路数扫描：每一步 %d 次回调，缓冲区时长 %.1f ms\n", SWEEP_CALLBACKS, buffer_period_ms());
+    for (size_t count = 1; count <= MAX_TRACKS; count *= 2) {
+        bool ok = open_tracks(count) && play_tracks(SWEEP_CALLBACKS);
+        close_tracks();
+        if (!ok)
+            return;
+        const StageTimer& cb = g_bench_stats.callback;
+        double avg_ms = cb.count ? cb.total * ms / cb.count : 0.0;
+        double max_ms = cb.max * ms;
+        unsigned long long underruns = g_underruns.load();
+        printf("  %2zu 路: 欠载 %llu 次, 回调平均 %.3f ms, 最大 %.3f ms\n", count, underruns, avg_ms, max_ms);
+        if (underruns > 0 || max_ms > buffer_period_ms()) {
+            failed = count;
+            break;
+        }
+        passed = count;
+    }
+    if (failed && passed == 0)
+        printf("实测上限: 1 路就出现欠载或回调超时\n");
+    else if (failed)
+        printf("实测上限: %zu 路没有欠载，%zu 路开始欠载或回调超时\n", passed, failed);
+    else
+        printf("实测上限: %d 路以内没有欠载\n", MAX_TRACKS);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "用法: " << argv[0] << " [--bench 回调次数] [--gain 增益] <输入PCM文件> [[--gain 增益] <输入PCM文件> ...]\n";
+        return -1;
+    }
 
-    return 0;
+    // --gain 只作用于紧随其后的一个输入，取值 0 到 2
+    int bench_callbacks = 0;
+    double gain = 1.0;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--bench" && i + 1 < argc) {
+            bench_callbacks = atoi(argv[++i]);
+        } else if (arg == "--gain" && i + 1 < argc) {
+            gain = atof(argv[++i]);
+        } else {
+            if (g_inputs.size() >= MAX_TRACKS) {
+                std::cerr << "最多支持 " << MAX_TRACKS << " 路输入\n";
+                return -1;
+            }
+            long q = lrint(gain * (1 << 14));
+            TrackInput in;
+            in.path = argv[i];
+            in.gain_q14 = (int16_t)(q < 0 ? 0 : (q > 32767 ? 32767 : q));
+            g_inputs.push_back(in);
+            gain = 1.0;
+        }
+    }
+    if (g_inputs.empty()) {
+        std::cerr << "没有输入文件\n";
+        return -1;
+    }
+
+    // 无头基准模式：disk 驱动写入 /dev/null，不按实时节奏回调
+    const bool user_delay = SDL_getenv("SDL_DISKAUDIODELAY") != NULL;
+    if (bench_callbacks > 0)
+        bench_use_headless_drivers();
+
+    // 初始化SDL音频子系统
+    if (SDL_Init(SDL_INIT_AUDIO) < 0) {
+        std::cerr << "无法初始化SDL - " << SDL_GetError() << "\n";
+        return -1;
+    }
+
+    int ret = 0;
+    if (!open_tracks(g_inputs.size()) || !play_tracks(bench_callbacks))
+        ret = -1;
+    if (ret == 0 && bench_callbacks > 0) {
+        print_audio_bench(g_bench_stats, SAMPLE_RATE * NUM_CHANNELS * 2);
+        printf("混音 %zu 路: 欠载 %llu 次\n", g_inputs.size(), (unsigned long long)g_underruns.load());
+    }
+    close_tracks();
+    if (ret == 0 && bench_callbacks > 0) {
+        AudioBenchStats unpaced = g_bench_stats; // 扫描会覆盖统计
+        run_mix_sweep(user_delay);
+        print_mix_estimate(unpaced, g_inputs.size());
+    }
+    SDL_Quit(); // 清理所有初始化的SDL子系统
+    return ret;
 }
@@ -2,6 +2,13 @@
 #include <iostream>
 #include <fstream>
 #include <thread>
+#include <string>
+#include <atomic>
+#include <cstdlib>
+
+#include "yuv_source.h"
+#include "headless_bench.h"
+#include "playback_metrics.h"
 
 #define SAMPLE_RATE 44100
 #define NUM_CHANNELS 2
@@ -10,14 +17,45 @@
 
 const int screen_width = 640;  // 修改为适合您的YUV文件的宽度
 const int screen_height = 360; // 修改为适合您的YUV文件的高度
+const int frame_interval_ms = 40; // 大约每秒25帧
+
+// 大于0时为无头基准模式：视频不限速地播放这么多帧，音频回调不按实时节奏调用
+static int g_bench_frames = 0;
+static AudioBenchStats g_audio_stats;
+static std::atomic<bool> g_audio_eof(false);
+static std::atomic<bool> g_video_done(false);
+
+// 运行指标，热路径上只做原子累加，由指标线程定期导出
+static PlaybackMetrics g_metrics;
 
 // 音频回调函数，将音频数据从文件读取到音频缓冲区中
 void audio_callback(void* userdata, Uint8* stream, int len) {
+    Uint64 t0 = SDL_GetPerformanceCounter();
     std::ifstream* audioFile = static_cast<std::ifstream*>(userdata);
     if (!audioFile->read(reinterpret_cast<char*>(stream), len)) {
         // 如果文件读取的数据少于 len，用静音数据填充剩余部分
         std::fill(stream + audioFile->gcount(), stream + len, 0);
+        g_audio_eof = true;
+    }
+    if (g_bench_frames > 0 && !g_audio_eof) {
+        stage_record(g_audio_stats.callback, t0);
+        g_audio_stats.callbacks++;
+        g_audio_stats.bytes += len;
     }
+
+    // 两次回调的间隔超过两个缓冲区时长，说明设备已经等了至少一个缓冲区，记为欠载
+    static Uint64 last_callback = 0;
+    const Uint64 freq = SDL_GetPerformanceFrequency();
+    const Uint64 period = (Uint64)len * freq / (SAMPLE_RATE * NUM_CHANNELS * 2);
+    if (last_callback != 0 && t0 - last_callback > 2 * period)
+        g_metrics.audio_underruns.fetch_add(1, std::memory_order_relaxed);
+    last_callback = t0;
+
+    Uint64 elapsed_ns = (SDL_GetPerformanceCounter() - t0) * 1000000000ULL / freq;
+    g_metrics.audio_callbacks.fetch_add(1, std::memory_order_relaxed);
+    g_metrics.audio_bytes.fetch_add(len, std::memory_order_relaxed);
+    g_metrics.audio_callback_ns.fetch_add(elapsed_ns, std::memory_order_relaxed);
+    metrics_update_max(g_metrics.audio_callback_max_ns, elapsed_ns);
 }
 
 // 播放音频的函数
@@ -50,22 +88,25 @@ void play_audio(const char* audio_filename) {
         return;
     }
 
+    g_audio_stats.start = SDL_GetPerformanceCounter();
     SDL_PauseAudio(0); // 开始播放音频
 
-    // 等待音频播放完成
-    while (!audioFile.eof()) {
-        SDL_Delay(100);
+    // 等待音频播放完成；基准模式下视频结束时也停止
+    while (!g_audio_eof && !(g_bench_frames > 0 && g_video_done)) {
+        SDL_Delay(g_bench_frames > 0 ? 1 : 100);
     }
 
     SDL_CloseAudio(); // 关闭音频设备
-    SDL_Quit(); // 清理所有初始化的SDL子系统
+    if (g_bench_frames > 0)
+        print_audio_bench(g_audio_stats, SAMPLE_RATE * NUM_CHANNELS * 2);
+    SDL_QuitSubSystem(SDL_INIT_AUDIO); // 只关闭音频子系统，视频可能还在播放
     audioFile.close(); // 关闭音频文件
 }
 
-// 播放视频的函数
-void play_video(const char* video_filename) {
-    std::ifstream yuvFile(video_filename, std::ios::binary);
-    if (!yuvFile.is_open()) {
+// 播放视频的函数，force_adaptive 为真时在硬件渲染器上也按窗口大小缩放后上传
+void play_video(const char* video_filename, bool force_adaptive) {
+    YuvFrameSource source;
+    if (!yuv_source_open(source, video_filename, screen_width, screen_height)) {
         std::cerr << "无法打开视频文件: " << video_filename << "\n";
         return;
     }
@@ -81,7 +122,8 @@ void play_video(const char* video_filename) {
                                           SDL_WINDOWPOS_UNDEFINED,
                                           SDL_WINDOWPOS_UNDEFINED,
                                           screen_width, screen_height,
-                                          SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
+                                          g_bench_frames > 0 ? SDL_WINDOW_RESIZABLE  // dummy 驱动不支持 OpenGL 窗口
+                                                             : SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
     if (!window) {
         std::cerr << "SDL: 无法创建窗口 - 退出: " << SDL_GetError() << "\n";
         return;
@@ -92,7 +134,7 @@ void play_video(const char* video_filename) {
     if (!renderer) {
         std::cerr << "SDL: 无法创建渲染器 - 退出: " << SDL_GetError() << "\n";
         SDL_DestroyWindow(window);
-        SDL_Quit();
+        SDL_QuitSubSystem(SDL_INIT_VIDEO);
         return;
     }
 
@@ -105,19 +147,34 @@ void play_video(const char* video_filename) {
         std::cerr << "SDL: 无法创建纹理 - 退出: " << SDL_GetError() << "\n";
         SDL_DestroyRenderer(renderer);
         SDL_DestroyWindow(window);
-        SDL_Quit();
+        SDL_QuitSubSystem(SDL_INIT_VIDEO);
         return;
     }
 
-    // 计算YUV数据的大小
-    const int y_size = screen_width * screen_height;
-    const int uv_size = y_size / 4;
-    char* buffer = new char[y_size + 2 * uv_size]; // 分配YUV数据缓冲区
+    // 软件渲染器上先把帧缩放到窗口大小再上传，上传和合成的数据量随窗口而不是源分辨率变化
+    SDL_RendererInfo info;
+    const bool adaptive = force_adaptive ||
+                          (SDL_GetRendererInfo(renderer, &info) == 0 && (info.flags & SDL_RENDERER_SOFTWARE));
+    int tex_width = screen_width, tex_height = screen_height;
+
+    // 后台线程负责读取和缩放，渲染循环只取帧、上传和渲染
+    yuv_source_start(source);
 
     bool quit = false;
     SDL_Event event;
 
-    while (!quit) {
+    // 基准模式的各阶段耗时
+    StageTimer stages[] = {StageTimer("read"), StageTimer("upload"), StageTimer("render"), StageTimer("present")};
+    const Uint64 bench_start = SDL_GetPerformanceCounter();
+    int bench_done = 0;
+
+    // 按固定时间表显示：第 n 帧在 play_start + n * frame_interval_ms 显示，不累积渲染耗时造成的漂移。
+    // 用64位的性能计数器计时，SDL_GetTicks 的32位毫秒数约49.7天回绕，长时间运行后时间表会失效
+    const Uint64 play_start = SDL_GetPerformanceCounter();
+    const Uint64 ticks_per_ms = SDL_GetPerformanceFrequency() / 1000;
+    Uint64 frame_index = 0;
+
+    while (!quit && (g_bench_frames == 0 || bench_done < g_bench_frames)) {
         // 处理SDL事件
         while (SDL_PollEvent(&event)) {
             if (event.type == SDL_QUIT) {
@@ -125,49 +182,132 @@ void play_video(const char* video_filename) {
             }
         }
 
-        // 读取YUV数据，如果读取失败则重新读取
-        if (!yuvFile.read(buffer, y_size + 2 * uv_size)) {
-            yuvFile.clear();
-            yuvFile.seekg(0, std::ios::beg);
-            yuvFile.read(buffer, y_size + 2 * uv_size);
+        // 跟踪窗口的实际输出尺寸，作为后台线程的缩放目标
+        if (adaptive) {
+            int out_w = 0, out_h = 0;
+            SDL_GetRendererOutputSize(renderer, &out_w, &out_h);
+            yuv_source_set_target(source, out_w, out_h);
+        }
+
+        // 落后时间表超过一帧时跳过（只取走不上传）这些帧，追上进度
+        if (g_bench_frames == 0) {
+            while ((SDL_GetPerformanceCounter() - play_start) / ticks_per_ms > (frame_index + 1) * frame_interval_ms &&
+                   yuv_source_take(source)) {
+                frame_index++;
+                g_metrics.frames_dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        // 取帧之前采样队列深度：取走后总是0，取之前为0表示渲染线程要等后台线程准备帧
+        g_metrics.video_queue_depth.store(source.queued.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        Uint64 t0 = SDL_GetPerformanceCounter();
+        bool taken = yuv_source_take(source);
+        stage_record(stages[0], t0);
+        if (taken) {
+            // 帧尺寸变化时按新尺寸重建纹理
+            if (source.front_width != tex_width || source.front_height != tex_height) {
+                tex_width = source.front_width;
+                tex_height = source.front_height;
+                SDL_DestroyTexture(texture);
+                texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_IYUV, SDL_TEXTUREACCESS_STREAMING,
+                                            tex_width, tex_height);
+                if (!texture) {
+                    std::cerr << "SDL: 无法重建纹理 - 退出: " << SDL_GetError() << "\n";
+                    break;
+                }
+                std::cout << "上传尺寸: " << tex_width << "x" << tex_height << "\n";
+            }
+            // 更新纹理
+            t0 = SDL_GetPerformanceCounter();
+            SDL_UpdateTexture(texture, nullptr, source.front.data(), tex_width);
+            stage_record(stages[1], t0);
         }
 
-        // 更新纹理并渲染
-        SDL_UpdateTexture(texture, nullptr, buffer, screen_width);
+        // 渲染
+        t0 = SDL_GetPerformanceCounter();
         SDL_RenderClear(renderer);
         SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+        stage_record(stages[2], t0);
+        t0 = SDL_GetPerformanceCounter();
         SDL_RenderPresent(renderer);
+        stage_record(stages[3], t0);
+        if (taken) {
+            frame_index++;
+            g_metrics.frames_rendered.fetch_add(1, std::memory_order_relaxed);
+        }
 
-        SDL_Delay(40); // 大约每秒25帧
+        if (g_bench_frames > 0) {
+            bench_done++;
+            continue;
+        }
+        // 等到下一帧的显示时间，单次最多等一帧
+        Uint64 elapsed = (SDL_GetPerformanceCounter() - play_start) / ticks_per_ms;
+        if (elapsed < frame_index * frame_interval_ms) {
+            Uint64 wait = frame_index * frame_interval_ms - elapsed;
+            SDL_Delay((Uint32)(wait < (Uint64)frame_interval_ms ? wait : frame_interval_ms));
+        }
+    }
+
+    if (g_bench_frames > 0) {
+        print_video_bench(bench_done, bench_start, stages, 4);
+        g_video_done = true;
     }
 
     // 释放资源
-    delete[] buffer;
-    SDL_DestroyTexture(texture);
+    yuv_source_close(source);
+    if (texture)
+        SDL_DestroyTexture(texture);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
-    SDL_Quit();
-    yuvFile.close();
+    SDL_QuitSubSystem(SDL_INIT_VIDEO);
 }
 
 // 主函数，处理命令行参数并启动音频和视频播放
 int main(int argc, char* argv[]) {
-    if (argc < 3) {
-        std::cerr << "用法: " << argv[0] << " <输入PCM文件> <输入YUV文件>\n";
+    const char* audio_filename = nullptr;
+    const char* video_filename = nullptr;
+    bool force_adaptive = false;
+    MetricsOptions metrics_opts;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--bench" && i + 1 < argc) {
+            g_bench_frames = atoi(argv[++i]);
+        } else if (arg == "--adaptive") {
+            force_adaptive = true;
+        } else if (parse_metrics_option(argc, argv, i, metrics_opts)) {
+        } else if (!audio_filename) {
+            audio_filename = argv[i];
+        } else if (!video_filename) {
+            video_filename = argv[i];
+        }
+    }
+    if (!audio_filename || !video_filename) {
+        std::cerr << "用法: " << argv[0] << " [--bench 帧数] " << metrics_options_usage()
+                  << " <输入PCM文件> <输入YUV文件> [--adaptive]\n";
         return -1;
     }
 
-    const char* audio_filename = argv[1];
-    const char* video_filename = argv[2];
+    // 无头基准模式：不需要显示器和声卡，不限速
+    if (g_bench_frames > 0)
+        bench_use_headless_drivers();
+
+    // 指标线程在播放线程之外读取计数器并导出
+    g_metrics.video_fps_x1000 = 1000000 / frame_interval_ms;
+    g_metrics.audio_bytes_per_second = SAMPLE_RATE * NUM_CHANNELS * 2;
+    MetricsExporter exporter;
+    if (!metrics_start(exporter, g_metrics, metrics_opts))
+        return -1;
 
     // 在单独的线程中启动音频播放
     std::thread audio_thread([audio_filename]() { play_audio(audio_filename); });
 
     // 在主线程中启动视频播放
-    play_video(video_filename);
+    play_video(video_filename, force_adaptive);
 
     // 等待音频线程完成
     audio_thread.join();
+    metrics_stop(exporter);
+    SDL_Quit(); // 清理所有初始化的SDL子系统
 
     return 0;
 }
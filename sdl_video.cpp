@@ -1,20 +1,290 @@
 #include <SDL2/SDL.h>
 #include <iostream>
 #include <fstream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+#include "yuv_source.h"
+#include "headless_bench.h"
 
 const int screen_width = 640; // 修改为适合您的YUV文件的宽度
 const int screen_height = 360; // 修改为适合您的YUV文件的高度
 
+const int max_mosaic_tiles = 16;
+
+// 大于0时为无头基准模式：不限速地播放这么多帧后退出
+static int g_bench_frames = 0;
+
+// 基准模式使用的 dummy 驱动不支持 OpenGL 窗口
+static Uint32 window_flags() {
+    return g_bench_frames > 0 ? SDL_WINDOW_RESIZABLE : SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE;
+}
+
+// 马赛克模式中的一路输入：读线程填充后台缓冲区，渲染线程取走后拷贝到图集纹理
+struct MosaicTile {
+    std::ifstream file;
+    std::vector<char> front;        // 渲染线程正在使用的帧
+    std::vector<char> back;         // 读线程填充的下一帧
+    bool ready = false;             // back 中有一帧尚未被取走
+    std::mutex mutex;
+    std::condition_variable cond;
+};
+
+// 读线程：循环读取YUV帧，每次等渲染线程取走上一帧后再读下一帧
+void mosaic_reader(MosaicTile* tile, const std::atomic<bool>* stop, size_t frame_size) {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(tile->mutex);
+            tile->cond.wait(lock, [&]() { return !tile->ready || *stop; });
+            if (*stop)
+                return;
+        }
+        // 读取YUV数据，如果读取失败则从头重新读取
+        if (!tile->file.read(tile->back.data(), frame_size)) {
+            tile->file.clear();
+            tile->file.seekg(0, std::ios::beg);
+            tile->file.read(tile->back.data(), frame_size);
+        }
+        std::lock_guard<std::mutex> lock(tile->mutex);
+        tile->ready = true;
+        tile->cond.notify_one();
+    }
+}
+
+// 把一帧 yuv420p 拷贝到锁定纹理（IYUV：Y平面后依次是U、V平面）中的指定位置
+void copy_tile(const char* frame, Uint8* pixels, int pitch, int tex_height, int x, int y) {
+    const int w = screen_width, h = screen_height;
+    Uint8* dst_y = pixels;
+    Uint8* dst_u = dst_y + pitch * tex_height;
+    Uint8* dst_v = dst_u + (pitch / 2) * (tex_height / 2);
+    const char* src_u = frame + w * h;
+    const char* src_v = src_u + w * h / 4;
+    for (int row = 0; row < h; row++)
+        memcpy(dst_y + (y + row) * pitch + x, frame + row * w, w);
+    for (int row = 0; row < h / 2; row++) {
+        memcpy(dst_u + (y / 2 + row) * (pitch / 2) + x / 2, src_u + row * w / 2, w / 2);
+        memcpy(dst_v + (y / 2 + row) * (pitch / 2) + x / 2, src_v + row * w / 2, w / 2);
+    }
+}
+
+// 马赛克模式：N 路YUV输入共用一个流式纹理，每次刷新只上传一次、渲染一次
+int play_mosaic(const std::vector<std::string>& filenames) {
+    const int count = (int)filenames.size();
+    const int cols = (int)ceil(sqrt((double)count));
+    const int rows = (count + cols - 1) / cols;
+    const int tex_width = cols * screen_width;
+    const int tex_height = rows * screen_height;
+    const size_t frame_size = (size_t)screen_width * screen_height * 3 / 2;
+
+    std::vector<std::unique_ptr<MosaicTile>> tiles;
+    for (const std::string& name : filenames) {
+        std::unique_ptr<MosaicTile> tile(new MosaicTile);
+        tile->file.open(name, std::ios::binary);
+        if (!tile->file.is_open()) {
+            std::cerr << "无法打开文件: " << name << "\n";
+            return -1;
+        }
+        tile->front.assign(frame_size, 0);
+        tile->back.assign(frame_size, 0);
+        tiles.push_back(std::move(tile));
+    }
+
+    // 初始化SDL视频子系统
+    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+        std::cerr << "无法初始化SDL - " << SDL_GetError() << "\n";
+        return -1;
+    }
+
+    // 窗口按图集比例缩小到单路画面的两倍宽，渲染时由 RenderCopy 缩放
+    const int window_width = screen_width * 2;
+    const int window_height = window_width * tex_height / tex_width;
+    SDL_Window* window = SDL_CreateWindow("YUV Mosaic",
+                                          SDL_WINDOWPOS_UNDEFINED,
+                                          SDL_WINDOWPOS_UNDEFINED,
+                                          window_width, window_height,
+                                          window_flags());
+    if (!window) {
+        std::cerr << "SDL: 无法创建窗口 - 退出: " << SDL_GetError() << "\n";
+        return -1;
+    }
+
+    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, 0);
+    if (!renderer) {
+        std::cerr << "SDL: 无法创建渲染器 - 退出: " << SDL_GetError() << "\n";
+        SDL_DestroyWindow(window);
+        SDL_Quit();
+        return -1;
+    }
+
+    // 所有输入共用的图集纹理
+    SDL_Texture* texture = SDL_CreateTexture(renderer,
+                                             SDL_PIXELFORMAT_IYUV,
+                                             SDL_TEXTUREACCESS_STREAMING,
+                                             tex_width, tex_height);
+    if (!texture) {
+        std::cerr << "SDL: 无法创建纹理 - 退出: " << SDL_GetError() << "\n";
+        SDL_DestroyRenderer(renderer);
+        SDL_DestroyWindow(window);
+        SDL_Quit();
+        return -1;
+    }
+
+    // 空白格子填充黑色
+    std::vector<char> black(frame_size, (char)128);
+    memset(black.data(), 16, (size_t)screen_width * screen_height);
+
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> readers;
+    for (auto& tile : tiles)
+        readers.emplace_back(mosaic_reader, tile.get(), &stop, frame_size);
+
+    bool quit = false;
+    SDL_Event event;
+    int frames = 0;
+    Uint32 fps_start = SDL_GetTicks();
+
+    // 基准模式的各阶段耗时
+    StageTimer stages[] = {StageTimer("read"), StageTimer("upload"), StageTimer("render"), StageTimer("present")};
+    const Uint64 bench_start = SDL_GetPerformanceCounter();
+    int bench_done = 0;
+
+    while (!quit && (g_bench_frames == 0 || bench_done < g_bench_frames)) {
+        Uint32 frame_start = SDL_GetTicks();
+
+        // 处理SDL事件
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SDL_QUIT) {
+                quit = true;
+            }
+        }
+
+        // 取走各路已经读好的帧，没读好的沿用上一帧；基准模式下等待每一路都读好
+        Uint64 t0 = SDL_GetPerformanceCounter();
+        for (auto& tile : tiles) {
+            std::unique_lock<std::mutex> lock(tile->mutex);
+            if (g_bench_frames > 0)
+                tile->cond.wait(lock, [&]() { return tile->ready; });
+            if (tile->ready) {
+                tile->front.swap(tile->back);
+                tile->ready = false;
+                tile->cond.notify_one();
+            }
+        }
+
+        stage_record(stages[0], t0);
+
+        // 锁定的纹理内容不保证保留，每次把所有格子完整写一遍
+        t0 = SDL_GetPerformanceCounter();
+        void* pixels = nullptr;
+        int pitch = 0;
+        if (SDL_LockTexture(texture, nullptr, &pixels, &pitch) == 0) {
+            Uint8* dst = static_cast<Uint8*>(pixels);
+            for (int i = 0; i < cols * rows; i++) {
+                int x = (i % cols) * screen_width;
+                int y = (i / cols) * screen_height;
+                const char* frame = i < count ? tiles[i]->front.data() : black.data();
+                copy_tile(frame, dst, pitch, tex_height, x, y);
+            }
+            SDL_UnlockTexture(texture);
+        }
+        stage_record(stages[1], t0);
+
+        t0 = SDL_GetPerformanceCounter();
+        SDL_RenderClear(renderer);
+        SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+        stage_record(stages[2], t0);
+        t0 = SDL_GetPerformanceCounter();
+        SDL_RenderPresent(renderer);
+        stage_record(stages[3], t0);
+
+        if (g_bench_frames > 0) {
+            bench_done++;
+            continue;
+        }
+
+        // 每秒输出一次实际帧率
+        frames++;
+        Uint32 now = SDL_GetTicks();
+        if (now - fps_start >= 1000) {
+            std::cout << "mosaic " << count << " 路: " << frames * 1000.0 / (now - fps_start) << " fps\n";
+            frames = 0;
+            fps_start = now;
+        }
+
+        // 大约每秒25帧，扣除本帧已经花费的时间
+        Uint32 spent = SDL_GetTicks() - frame_start;
+        if (spent < 40)
+            SDL_Delay(40 - spent);
+    }
+
+    if (g_bench_frames > 0) {
+        std::cout << "mosaic " << count << " 路\n";
+        print_video_bench(bench_done, bench_start, stages, 4);
+    }
+
+    // 通知读线程退出
+    stop = true;
+    for (auto& tile : tiles) {
+        std::lock_guard<std::mutex> lock(tile->mutex);
+        tile->cond.notify_one();
+    }
+    for (auto& reader : readers)
+        reader.join();
+
+    SDL_DestroyTexture(texture);
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        std::cerr << "用法: " << argv[0] << " <输入YUV文件>\n";
+    std::vector<std::string> filenames;
+    bool mosaic = false;
+    bool force_adaptive = false; // --adaptive 在硬件渲染器上也按窗口大小缩放后上传
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--mosaic") {
+            mosaic = true;
+        } else if (arg == "--adaptive") {
+            force_adaptive = true;
+        } else if (arg == "--bench" && i + 1 < argc) {
+            g_bench_frames = atoi(argv[++i]);
+        } else {
+            filenames.push_back(arg);
+        }
+    }
+
+    if (filenames.empty() || (!mosaic && filenames.size() > 1)) {
+        std::cerr << "用法: " << argv[0] << " [--bench 帧数] <输入YUV文件> [--adaptive]\n";
+        std::cerr << "      " << argv[0] << " [--bench 帧数] --mosaic <YUV文件1> ... <YUV文件N>  (N <= " << max_mosaic_tiles << ")\n";
         return -1;
     }
 
-    const char* input_filename = argv[1];
+    // 无头基准模式：不需要显示器，不限速
+    if (g_bench_frames > 0)
+        bench_use_headless_drivers();
+
+    if (mosaic) {
+        if ((int)filenames.size() > max_mosaic_tiles) {
+            std::cerr << "马赛克模式需要 1 到 " << max_mosaic_tiles << " 个输入文件\n";
+            return -1;
+        }
+        return play_mosaic(filenames);
+    }
+
+    const char* input_filename = filenames[0].c_str();
+
     // 打开输入的YUV文件
-    std::ifstream yuvFile(input_filename, std::ios::binary);
-    if (!yuvFile.is_open()) {
+    YuvFrameSource source;
+    if (!yuv_source_open(source, input_filename, screen_width, screen_height)) {
         std::cerr << "无法打开文件: " << input_filename << "\n";
         return -1;
     }
@@ -30,7 +300,7 @@ int main(int argc, char* argv[]) {
                                           SDL_WINDOWPOS_UNDEFINED,
                                           SDL_WINDOWPOS_UNDEFINED,
                                           screen_width, screen_height,
-                                          SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
+                                          window_flags());
     if (!window) {
         std::cerr << "SDL: 无法创建窗口 - 退出: " << SDL_GetError() << "\n";
         return -1;
@@ -58,15 +328,24 @@ int main(int argc, char* argv[]) {
         return -1;
     }
 
-    // 计算YUV数据的大小
-    const int y_size = screen_width * screen_height;
-    const int uv_size = y_size / 4;
-    char* buffer = new char[y_size + 2 * uv_size]; // 分配YUV数据缓冲区
+    // 软件渲染器上先把帧缩放到窗口大小再上传，上传和合成的数据量随窗口而不是源分辨率变化
+    SDL_RendererInfo info;
+    const bool adaptive = force_adaptive ||
+                          (SDL_GetRendererInfo(renderer, &info) == 0 && (info.flags & SDL_RENDERER_SOFTWARE));
+    int tex_width = screen_width, tex_height = screen_height;
+
+    // 后台线程负责读取和缩放，渲染循环只取帧、上传和渲染
+    yuv_source_start(source);
 
     bool quit = false;
     SDL_Event event;
 
-    while (!quit) {
+    // 基准模式的各阶段耗时
+    StageTimer stages[] = {StageTimer("read"), StageTimer("upload"), StageTimer("render"), StageTimer("present")};
+    const Uint64 bench_start = SDL_GetPerformanceCounter();
+    int bench_done = 0;
+
+    while (!quit && (g_bench_frames == 0 || bench_done < g_bench_frames)) {
         // 处理SDL事件
         while (SDL_PollEvent(&event)) {
             if (event.type == SDL_QUIT) {
@@ -74,29 +353,62 @@ int main(int argc, char* argv[]) {
             }
         }
 
-        // 读取YUV数据，如果读取失败则重新读取
-        if (!yuvFile.read(buffer, y_size + 2 * uv_size)) {
-            yuvFile.clear();
-            yuvFile.seekg(0, std::ios::beg);
-            yuvFile.read(buffer, y_size + 2 * uv_size);
+        // 跟踪窗口的实际输出尺寸，作为后台线程的缩放目标
+        if (adaptive) {
+            int out_w = 0, out_h = 0;
+            SDL_GetRendererOutputSize(renderer, &out_w, &out_h);
+            yuv_source_set_target(source, out_w, out_h);
         }
 
-        // 更新纹理并渲染
-        SDL_UpdateTexture(texture, nullptr, buffer, screen_width);
+        Uint64 t0 = SDL_GetPerformanceCounter();
+        bool taken = yuv_source_take(source);
+        stage_record(stages[0], t0);
+        if (taken) {
+            // 帧尺寸变化时按新尺寸重建纹理
+            if (source.front_width != tex_width || source.front_height != tex_height) {
+                tex_width = source.front_width;
+                tex_height = source.front_height;
+                SDL_DestroyTexture(texture);
+                texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_IYUV, SDL_TEXTUREACCESS_STREAMING,
+                                            tex_width, tex_height);
+                if (!texture) {
+                    std::cerr << "SDL: 无法重建纹理 - 退出: " << SDL_GetError() << "\n";
+                    break;
+                }
+                std::cout << "上传尺寸: " << tex_width << "x" << tex_height << "\n";
+            }
+            // 更新纹理
+            t0 = SDL_GetPerformanceCounter();
+            SDL_UpdateTexture(texture, nullptr, source.front.data(), tex_width);
+            stage_record(stages[1], t0);
+        }
+
+        // 渲染
+        t0 = SDL_GetPerformanceCounter();
         SDL_RenderClear(renderer);
         SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+        stage_record(stages[2], t0);
+        t0 = SDL_GetPerformanceCounter();
         SDL_RenderPresent(renderer);
+        stage_record(stages[3], t0);
 
+        if (g_bench_frames > 0) {
+            bench_done++;
+            continue;
+        }
         SDL_Delay(40); // 大约每秒25帧
     }
 
+    if (g_bench_frames > 0)
+        print_video_bench(bench_done, bench_start, stages, 4);
+
     // 释放资源
-    delete[] buffer;
-    SDL_DestroyTexture(texture);
+    yuv_source_close(source);
+    if (texture)
+        SDL_DestroyTexture(texture);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
-    yuvFile.close();
 
     return 0;
 }
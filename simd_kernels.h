@@ -0,0 +1,337 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+/* 各个工具共用的逐帧计算内核，x86 上使用 SSE2，其它平台退回标量实现 */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// 计算一行像素的差值平方和（标量版本）
+static inline uint64_t sse_line_c(const uint8_t *a, const uint8_t *b, int width) {
+    uint64_t sum = 0;
+    for (int x = 0; x < width; x++) {
+        int d = a[x] - b[x];
+        sum += d * d;
+    }
+    return sum;
+}
+
+// 计算一行像素的差值平方和（SSE2版本），每次处理16个像素
+static inline uint64_t sse_line_simd(const uint8_t *a, const uint8_t *b, int width) {
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = _mm_setzero_si128();
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i va = _mm_loadu_si128((const __m128i *)(a + x));
+        __m128i vb = _mm_loadu_si128((const __m128i *)(b + x));
+        __m128i dlo = _mm_sub_epi16(_mm_unpacklo_epi8(va, zero), _mm_unpacklo_epi8(vb, zero));
+        __m128i dhi = _mm_sub_epi16(_mm_unpackhi_epi8(va, zero), _mm_unpackhi_epi8(vb, zero));
+        // madd 把相邻两个16位平方相加成32位，单行宽度内不会溢出
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(dlo, dlo));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(dhi, dhi));
+    }
+    uint32_t lanes[4];
+    _mm_storeu_si128((__m128i *)lanes, acc);
+    uint64_t sum = (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    return sum + sse_line_c(a + x, b + x, width - x);
+#else
+    return sse_line_c(a, b, width);
+#endif
+}
+
+// 计算整个平面的差值平方和
+static inline uint64_t sse_plane(const uint8_t *a, int stride_a, const uint8_t *b, int stride_b,
+                                 int width, int height) {
+    uint64_t sum = 0;
+    for (int y = 0; y < height; y++)
+        sum += sse_line_simd(a + (size_t)y * stride_a, b + (size_t)y * stride_b, width);
+    return sum;
+}
+
+// 计算一排4x4块的 SSIM 统计量：sums[i] = {s1, s2, ss, s12}（标量版本）
+static inline void ssim_4x4_row_c(const uint8_t *a, int stride_a, const uint8_t *b, int stride_b,
+                                  int blocks, int (*sums)[4]) {
+    for (int i = 0; i < blocks; i++) {
+        int s1 = 0, s2 = 0, ss = 0, s12 = 0;
+        for (int y = 0; y < 4; y++) {
+            for (int x = 0; x < 4; x++) {
+                int pa = a[y * stride_a + i * 4 + x];
+                int pb = b[y * stride_b + i * 4 + x];
+                s1 += pa;
+                s2 += pb;
+                ss += pa * pa + pb * pb;
+                s12 += pa * pb;
+            }
+        }
+        sums[i][0] = s1;
+        sums[i][1] = s2;
+        sums[i][2] = ss;
+        sums[i][3] = s12;
+    }
+}
+
+// 计算一排4x4块的 SSIM 统计量（SSE2版本），每次处理两个相邻的4x4块
+static inline void ssim_4x4_row_simd(const uint8_t *a, int stride_a, const uint8_t *b, int stride_b,
+                                     int blocks, int (*sums)[4]) {
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+    int i = 0;
+    for (; i + 2 <= blocks; i += 2) {
+        __m128i s1 = zero, s2 = zero, ss = zero, s12 = zero;
+        for (int y = 0; y < 4; y++) {
+            __m128i va = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(a + y * stride_a + i * 4)), zero);
+            __m128i vb = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(b + y * stride_b + i * 4)), zero);
+            s1 = _mm_add_epi32(s1, _mm_madd_epi16(va, ones));
+            s2 = _mm_add_epi32(s2, _mm_madd_epi16(vb, ones));
+            ss = _mm_add_epi32(ss, _mm_add_epi32(_mm_madd_epi16(va, va), _mm_madd_epi16(vb, vb)));
+            s12 = _mm_add_epi32(s12, _mm_madd_epi16(va, vb));
+        }
+        // 32位通道0、1属于第一个块，通道2、3属于第二个块
+        int t[4][4];
+        _mm_storeu_si128((__m128i *)t[0], s1);
+        _mm_storeu_si128((__m128i *)t[1], s2);
+        _mm_storeu_si128((__m128i *)t[2], ss);
+        _mm_storeu_si128((__m128i *)t[3], s12);
+        for (int k = 0; k < 4; k++) {
+            sums[i][k] = t[k][0] + t[k][1];
+            sums[i + 1][k] = t[k][2] + t[k][3];
+        }
+    }
+    if (i < blocks)
+        ssim_4x4_row_c(a + i * 4, stride_a, b + i * 4, stride_b, blocks - i, sums + i);
+#else
+    ssim_4x4_row_c(a, stride_a, b, stride_b, blocks, sums);
+#endif
+}
+
+// 由8x8窗口的统计量计算 SSIM，常数取自 x264 的8位实现
+static inline float ssim_end(int s1, int s2, int ss, int s12) {
+    static const int ssim_c1 = (int)(.01 * .01 * 255 * 255 * 64 + .5);
+    static const int ssim_c2 = (int)(.03 * .03 * 255 * 255 * 64 * 63 + .5);
+    int vars = ss * 64 - s1 * s1 - s2 * s2;
+    int covar = s12 * 64 - s1 * s2;
+    return (float)(2 * s1 * s2 + ssim_c1) * (float)(2 * covar + ssim_c2) /
+           ((float)(s1 * s1 + s2 * s2 + ssim_c1) * (float)(vars + ssim_c2));
+}
+
+// 计算整个平面的 SSIM：8x8窗口，步长为4，tmp 至少需要 2*(width/4) 个元素
+static inline double ssim_plane(const uint8_t *a, int stride_a, const uint8_t *b, int stride_b,
+                                int width, int height, int (*tmp)[4]) {
+    int bw = width / 4, bh = height / 4;
+    if (bw < 2 || bh < 2)
+        return 1.0;
+
+    int (*prev)[4] = tmp;
+    int (*cur)[4] = tmp + bw;
+    double total = 0.0;
+    ssim_4x4_row_simd(a, stride_a, b, stride_b, bw, prev);
+    for (int y = 1; y < bh; y++) {
+        ssim_4x4_row_simd(a + (size_t)y * 4 * stride_a, stride_a, b + (size_t)y * 4 * stride_b, stride_b, bw, cur);
+        for (int x = 0; x + 1 < bw; x++) {
+            int s[4];
+            for (int k = 0; k < 4; k++)
+                s[k] = prev[x][k] + prev[x + 1][k] + cur[x][k] + cur[x + 1][k];
+            total += ssim_end(s[0], s[1], s[2], s[3]);
+        }
+        int (*swap)[4] = prev;
+        prev = cur;
+        cur = swap;
+    }
+    return total / ((double)(bw - 1) * (bh - 1));
+}
+
+// 对一段浮点采样求最小值、最大值和平方和（标量版本）
+static inline void peak_reduce_c(const float *src, int n, float *pmin, float *pmax, double *psumsq) {
+    float lo = *pmin, hi = *pmax;
+    double sumsq = 0.0;
+    for (int i = 0; i < n; i++) {
+        float v = src[i];
+        lo = v < lo ? v : lo;
+        hi = v > hi ? v : hi;
+        sumsq += (double)v * v;
+    }
+    *pmin = lo;
+    *pmax = hi;
+    *psumsq += sumsq;
+}
+
+// 对一段浮点采样求最小值、最大值和平方和（SSE2版本），结果累加到 pmin/pmax/psumsq
+static inline void peak_reduce_simd(const float *src, int n, float *pmin, float *pmax, double *psumsq) {
+#if defined(__SSE2__)
+    __m128 lo = _mm_set1_ps(*pmin);
+    __m128 hi = _mm_set1_ps(*pmax);
+    __m128 sq = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 v = _mm_loadu_ps(src + i);
+        lo = _mm_min_ps(lo, v);
+        hi = _mm_max_ps(hi, v);
+        sq = _mm_add_ps(sq, _mm_mul_ps(v, v));
+    }
+    float l[4], h[4], q[4];
+    _mm_storeu_ps(l, lo);
+    _mm_storeu_ps(h, hi);
+    _mm_storeu_ps(q, sq);
+    for (int k = 0; k < 4; k++) {
+        *pmin = l[k] < *pmin ? l[k] : *pmin;
+        *pmax = h[k] > *pmax ? h[k] : *pmax;
+    }
+    // 单次调用只处理一个峰值块，单精度部分和的误差可以忽略
+    *psumsq += (double)q[0] + q[1] + q[2] + q[3];
+    peak_reduce_c(src + i, n - i, pmin, pmax, psumsq);
+#else
+    peak_reduce_c(src, n, pmin, pmax, psumsq);
+#endif
+}
+
+// 把平面浮点采样交错存放：dst[i * channels + ch] = src[ch][i]（标量版本）
+static inline void interleave_f32_c(const float *const *src, int channels, int n, float *dst) {
+    for (int i = 0; i < n; i++)
+        for (int ch = 0; ch < channels; ch++)
+            dst[i * channels + ch] = src[ch][i];
+}
+
+// 平面浮点采样交错（SSE2版本），单声道直接拷贝，双声道用 unpack，4的倍数声道用4x4转置，其它情况退回标量
+static inline void interleave_f32_simd(const float *const *src, int channels, int n, float *dst) {
+    if (channels == 1) {
+        memcpy(dst, src[0], sizeof(float) * n);
+        return;
+    }
+#if defined(__SSE2__)
+    int i = 0;
+    if (channels == 2) {
+        for (; i + 4 <= n; i += 4) {
+            __m128 l = _mm_loadu_ps(src[0] + i);
+            __m128 r = _mm_loadu_ps(src[1] + i);
+            _mm_storeu_ps(dst + i * 2, _mm_unpacklo_ps(l, r));
+            _mm_storeu_ps(dst + i * 2 + 4, _mm_unpackhi_ps(l, r));
+        }
+    } else if (channels % 4 == 0) {
+        for (; i + 4 <= n; i += 4) {
+            for (int ch = 0; ch < channels; ch += 4) {
+                __m128 r0 = _mm_loadu_ps(src[ch] + i);
+                __m128 r1 = _mm_loadu_ps(src[ch + 1] + i);
+                __m128 r2 = _mm_loadu_ps(src[ch + 2] + i);
+                __m128 r3 = _mm_loadu_ps(src[ch + 3] + i);
+                _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+                _mm_storeu_ps(dst + (i + 0) * channels + ch, r0);
+                _mm_storeu_ps(dst + (i + 1) * channels + ch, r1);
+                _mm_storeu_ps(dst + (i + 2) * channels + ch, r2);
+                _mm_storeu_ps(dst + (i + 3) * channels + ch, r3);
+            }
+        }
+    }
+    for (; i < n; i++)
+        for (int ch = 0; ch < channels; ch++)
+            dst[i * channels + ch] = src[ch][i];
+#else
+    interleave_f32_c(src, channels, n, dst);
+#endif
+}
+
+// 按 Q14 增益把 src 饱和累加到 dst：dst = sat(dst + sat((src * gain) >> 14))（标量版本）
+static inline void mix_s16_c(int16_t *dst, const int16_t *src, int n, int16_t gain_q14) {
+    for (int i = 0; i < n; i++) {
+        int p = ((int)src[i] * gain_q14) >> 14;
+        p = p > 32767 ? 32767 : (p < -32768 ? -32768 : p);
+        int v = dst[i] + p;
+        dst[i] = (int16_t)(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+    }
+}
+
+// 带增益的饱和混音（SSE2版本）：16位乘法的高低半部分拼成32位积，移位后饱和打包，再饱和相加
+static inline void mix_s16_simd(int16_t *dst, const int16_t *src, int n, int16_t gain_q14) {
+#if defined(__SSE2__)
+    const __m128i g = _mm_set1_epi16(gain_q14);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i lo = _mm_mullo_epi16(s, g);
+        __m128i hi = _mm_mulhi_epi16(s, g);
+        __m128i p0 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 14);
+        __m128i p1 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 14);
+        __m128i p = _mm_packs_epi32(p0, p1);
+        __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_adds_epi16(d, p));
+    }
+    mix_s16_c(dst + i, src + i, n - i, gain_q14);
+#else
+    mix_s16_c(dst, src, n, gain_q14);
+#endif
+}
+
+/*
+ * 去重用的帧哈希：每行按16字节块累加到两个64位累加器（与 XXH3 的累加方式相同：
+ * 数据异或密钥后高低32位相乘，再加上另一半数据），密钥随块在行内的位置递增，
+ * 行末在标量中打乱一次，使块和行的位置都参与哈希。哈希相同时调用方还要逐字节比较。
+ */
+static const uint32_t FRAME_HASH_SECRET[4] = {0x9e3779b1u, 0x85ebca77u, 0xc2b2ae3du, 0x27d4eb2fu};
+static const uint32_t FRAME_HASH_STEP = 0x165667b1u;
+
+// 行尾不足16字节的部分和行末打乱，标量和SSE2版本共用
+static inline void frame_hash_row_end(uint64_t acc[2], const uint8_t *p, int n) {
+    for (int i = 0; i < n; i++)
+        acc[0] = (acc[0] ^ p[i]) * 0x100000001b3ULL;
+    uint64_t a = acc[0], b = acc[1];
+    acc[0] = (a ^ (b >> 29)) * 0xbf58476d1ce4e5b9ULL;
+    acc[1] = (b ^ (a >> 31)) * 0x94d049bb133111ebULL;
+}
+
+// 累加一行像素（标量版本）
+static inline void frame_hash_row_c(uint64_t acc[2], const uint8_t *p, int width) {
+    uint32_t key[4] = {FRAME_HASH_SECRET[0], FRAME_HASH_SECRET[1], FRAME_HASH_SECRET[2], FRAME_HASH_SECRET[3]};
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint64_t d0, d1;
+        memcpy(&d0, p + x, 8);
+        memcpy(&d1, p + x + 8, 8);
+        uint64_t k0 = d0 ^ ((uint64_t)key[1] << 32 | key[0]);
+        uint64_t k1 = d1 ^ ((uint64_t)key[3] << 32 | key[2]);
+        acc[0] += (k0 & 0xffffffffu) * (k0 >> 32) + d1;
+        acc[1] += (k1 & 0xffffffffu) * (k1 >> 32) + d0;
+        for (int j = 0; j < 4; j++)
+            key[j] += FRAME_HASH_STEP;
+    }
+    frame_hash_row_end(acc, p + x, width - x);
+}
+
+// 累加一行像素（SSE2版本）：mul_epu32 一次完成两个32x32->64位乘法
+static inline void frame_hash_row_simd(uint64_t acc[2], const uint8_t *p, int width) {
+#if defined(__SSE2__)
+    __m128i key = _mm_loadu_si128((const __m128i *)FRAME_HASH_SECRET);
+    const __m128i step = _mm_set1_epi32((int)FRAME_HASH_STEP);
+    __m128i vacc = _mm_loadu_si128((const __m128i *)acc);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + x));
+        __m128i dk = _mm_xor_si128(v, key);
+        __m128i hi = _mm_shuffle_epi32(dk, _MM_SHUFFLE(0, 3, 0, 1));
+        __m128i swapped = _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+        vacc = _mm_add_epi64(vacc, _mm_add_epi64(_mm_mul_epu32(dk, hi), swapped));
+        key = _mm_add_epi32(key, step);
+    }
+    _mm_storeu_si128((__m128i *)acc, vacc);
+    frame_hash_row_end(acc, p + x, width - x);
+#else
+    frame_hash_row_c(acc, p, width);
+#endif
+}
+
+// 计算一个平面的哈希，seed 传入前一个平面的结果即可把多个平面串起来
+static inline uint64_t frame_hash_plane(const uint8_t *p, int stride, int width, int height, uint64_t seed) {
+    uint64_t acc[2] = {seed, seed ^ 0x9e3779b97f4a7c15ULL};
+    for (int y = 0; y < height; y++)
+        frame_hash_row_simd(acc, p + (size_t)y * stride, width);
+    uint64_t h = acc[0] ^ (acc[1] << 32 | acc[1] >> 32);
+    h = (h ^ (h >> 33)) * 0xff51afd7ed558ccdULL;
+    return h ^ (h >> 33);
+}
+
+#endif // SIMD_KERNELS_H
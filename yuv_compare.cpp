@@ -0,0 +1,176 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "simd_kernels.h"
+
+/* 比较两个 yuv420p 原始文件（例如 save_yuv 的输出），逐帧计算 PSNR 和 SSIM */
+
+// 只读映射的输入文件
+struct MappedFile {
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+};
+
+// 以只读方式把整个文件映射到内存
+bool map_file(const char *filename, MappedFile &file) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "无法打开文件: " << filename << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        std::cerr << "文件为空或无法获取大小: " << filename << std::endl;
+        close(fd);
+        return false;
+    }
+    void *ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        std::cerr << "mmap 失败: " << filename << std::endl;
+        return false;
+    }
+    madvise(ptr, st.st_size, MADV_SEQUENTIAL);
+    file.data = static_cast<const uint8_t *>(ptr);
+    file.size = st.st_size;
+    return true;
+}
+
+void unmap_file(MappedFile &file) {
+    if (file.data)
+        munmap(const_cast<uint8_t *>(file.data), file.size);
+    file.data = nullptr;
+    file.size = 0;
+}
+
+// 单帧的比较结果
+struct FrameResult {
+    uint64_t sse[3];
+    double ssim[3];
+};
+
+// 由差值平方和计算 PSNR，完全相同时返回无穷大
+double psnr_from_sse(double sse, double pixels) {
+    if (sse <= 0)
+        return INFINITY;
+    return 10.0 * log10(255.0 * 255.0 * pixels / sse);
+}
+
+// 比较一帧的 Y、U、V 三个平面
+void compare_frame(const uint8_t *a, const uint8_t *b, int width, int height,
+                   std::vector<int> &tmp, FrameResult &result) {
+    const int w[3] = {width, width / 2, width / 2};
+    const int h[3] = {height, height / 2, height / 2};
+    size_t offset = 0;
+    for (int p = 0; p < 3; p++) {
+        result.sse[p] = sse_plane(a + offset, w[p], b + offset, w[p], w[p], h[p]);
+        result.ssim[p] = ssim_plane(a + offset, w[p], b + offset, w[p], w[p], h[p],
+                                    reinterpret_cast<int (*)[4]>(tmp.data()));
+        offset += (size_t)w[p] * h[p];
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 5) {
+        std::cerr << "用法: " << argv[0] << " <YUV文件A> <YUV文件B> <宽> <高> [线程数]" << std::endl;
+        return -1;
+    }
+
+    const int width = atoi(argv[3]);
+    const int height = atoi(argv[4]);
+    int num_threads = argc > 5 ? atoi(argv[5]) : (int)std::thread::hardware_concurrency();
+    if (width <= 0 || height <= 0 || (width & 1) || (height & 1)) {
+        std::cerr << "宽高必须为正偶数" << std::endl;
+        return -1;
+    }
+    if (num_threads <= 0)
+        num_threads = 1;
+
+    MappedFile fileA, fileB;
+    if (!map_file(argv[1], fileA))
+        return -1;
+    if (!map_file(argv[2], fileB)) {
+        unmap_file(fileA);
+        return -1;
+    }
+
+    // 计算帧大小和帧数，两个文件长度不同时只比较公共部分
+    const size_t frame_size = (size_t)width * height * 3 / 2;
+    const size_t framesA = fileA.size / frame_size;
+    const size_t framesB = fileB.size / frame_size;
+    const size_t num_frames = framesA < framesB ? framesA : framesB;
+    if (framesA != framesB)
+        std::cerr << "警告: 帧数不一致 (" << framesA << " vs " << framesB << ")，只比较前 "
+                  << num_frames << " 帧" << std::endl;
+    if (num_frames == 0) {
+        std::cerr << "没有可比较的完整帧" << std::endl;
+        unmap_file(fileA);
+        unmap_file(fileB);
+        return -1;
+    }
+
+    // 线程池：每个线程从共享计数器领取下一帧，结果按帧号写入
+    std::vector<FrameResult> results(num_frames);
+    std::atomic<size_t> next_frame(0);
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < num_threads; t++) {
+        workers.emplace_back([&]() {
+            std::vector<int> tmp((size_t)2 * (width / 4) * 4);
+            size_t i;
+            while ((i = next_frame.fetch_add(1)) < num_frames) {
+                compare_frame(fileA.data + i * frame_size, fileB.data + i * frame_size,
+                              width, height, tmp, results[i]);
+            }
+        });
+    }
+    for (auto &worker : workers)
+        worker.join();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // 输出逐帧结果并累计总体指标
+    const double pixels[3] = {(double)width * height, (double)width * height / 4, (double)width * height / 4};
+    uint64_t total_sse[3] = {0, 0, 0};
+    double total_ssim[3] = {0, 0, 0};
+    for (size_t i = 0; i < num_frames; i++) {
+        const FrameResult &r = results[i];
+        uint64_t sse_all = r.sse[0] + r.sse[1] + r.sse[2];
+        double ssim_all = (r.ssim[0] * 4 + r.ssim[1] + r.ssim[2]) / 6;
+        printf("frame:%zu psnr_y:%.2f psnr_u:%.2f psnr_v:%.2f psnr_avg:%.2f ssim_y:%.4f ssim_u:%.4f ssim_v:%.4f ssim_all:%.4f\n",
+               i, psnr_from_sse(r.sse[0], pixels[0]), psnr_from_sse(r.sse[1], pixels[1]),
+               psnr_from_sse(r.sse[2], pixels[2]), psnr_from_sse(sse_all, frame_size),
+               r.ssim[0], r.ssim[1], r.ssim[2], ssim_all);
+        for (int p = 0; p < 3; p++) {
+            total_sse[p] += r.sse[p];
+            total_ssim[p] += r.ssim[p];
+        }
+    }
+
+    const double n = (double)num_frames;
+    printf("总计 %zu 帧  PSNR y:%.2f u:%.2f v:%.2f avg:%.2f  SSIM y:%.4f u:%.4f v:%.4f all:%.4f\n",
+           num_frames,
+           psnr_from_sse(total_sse[0], pixels[0] * n), psnr_from_sse(total_sse[1], pixels[1] * n),
+           psnr_from_sse(total_sse[2], pixels[2] * n),
+           psnr_from_sse(total_sse[0] + total_sse[1] + total_sse[2], frame_size * n),
+           total_ssim[0] / n, total_ssim[1] / n, total_ssim[2] / n,
+           (total_ssim[0] * 4 + total_ssim[1] + total_ssim[2]) / 6 / n);
+    printf("耗时 %.3f 秒，%d 线程，%.1f 帧/秒\n", seconds, num_threads, n / seconds);
+
+    unmap_file(fileA);
+    unmap_file(fileB);
+    return 0;
+}
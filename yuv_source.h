@@ -0,0 +1,155 @@
+#ifndef YUV_SOURCE_H
+#define YUV_SOURCE_H
+
+/*
+ * 播放器用的YUV帧来源：后台线程循环读取 yuv420p 文件，并按目标尺寸缩放（libswscale），
+ * 渲染线程只负责取走准备好的帧并上传纹理。目标尺寸跟随窗口大小时，
+ * 上传和合成的字节数与窗口大小成正比，而不是与源分辨率成正比。
+ */
+
+extern "C" {
+#include <libswscale/swscale.h>
+}
+
+#include <fstream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+
+struct YuvFrameSource {
+    std::ifstream file;
+    int src_width = 0;
+    int src_height = 0;
+    std::atomic<int> target_width;
+    std::atomic<int> target_height;
+
+    std::vector<char> raw;              // 从文件读出的原始帧
+    std::vector<char> back;             // 后台线程准备好的帧
+    int back_width = 0, back_height = 0;
+    std::vector<char> front;            // 渲染线程正在使用的帧
+    int front_width = 0, front_height = 0;
+
+    bool ready = false;                 // back 中有一帧尚未被取走
+    std::atomic<int> queued{0};         // ready 的无锁副本，供统计读取
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::atomic<bool> stop;
+    std::thread worker;
+    struct SwsContext* sws = nullptr;
+};
+
+// 读取下一帧原始数据，读到末尾后从头开始
+static void yuv_source_read(YuvFrameSource& src, char* dst) {
+    const size_t frame_size = (size_t)src.src_width * src.src_height * 3 / 2;
+    if (!src.file.read(dst, frame_size)) {
+        src.file.clear();
+        src.file.seekg(0, std::ios::beg);
+        src.file.read(dst, frame_size);
+    }
+}
+
+// 把原始帧缩放到 w x h，写入 back
+static void yuv_source_scale(YuvFrameSource& src, int w, int h) {
+    src.sws = sws_getCachedContext(src.sws, src.src_width, src.src_height, AV_PIX_FMT_YUV420P,
+                                   w, h, AV_PIX_FMT_YUV420P, SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
+    src.back.resize((size_t)w * h * 3 / 2);
+    const int sw = src.src_width, sh = src.src_height;
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(src.raw.data());
+    uint8_t* out = reinterpret_cast<uint8_t*>(src.back.data());
+    const uint8_t* const src_planes[3] = {in, in + sw * sh, in + sw * sh + sw * sh / 4};
+    const int src_strides[3] = {sw, sw / 2, sw / 2};
+    uint8_t* const dst_planes[3] = {out, out + w * h, out + w * h + w * h / 4};
+    const int dst_strides[3] = {w, w / 2, w / 2};
+    sws_scale(src.sws, src_planes, src_strides, 0, sh, dst_planes, dst_strides);
+}
+
+// 后台线程：等上一帧被取走后读取并按当前目标尺寸准备下一帧
+static void yuv_source_worker(YuvFrameSource* src) {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(src->mutex);
+            src->cond.wait(lock, [&]() { return !src->ready || src->stop; });
+            if (src->stop)
+                return;
+        }
+        int w = src->target_width, h = src->target_height;
+        if (w == src->src_width && h == src->src_height) {
+            src->back.resize((size_t)w * h * 3 / 2);
+            yuv_source_read(*src, src->back.data());
+        } else {
+            yuv_source_read(*src, src->raw.data());
+            yuv_source_scale(*src, w, h);
+        }
+        std::lock_guard<std::mutex> lock(src->mutex);
+        src->back_width = w;
+        src->back_height = h;
+        src->ready = true;
+        src->queued.store(1, std::memory_order_relaxed);
+        src->cond.notify_all();
+    }
+}
+
+// 打开YUV文件，初始目标尺寸为源尺寸
+static bool yuv_source_open(YuvFrameSource& src, const char* filename, int width, int height) {
+    src.file.open(filename, std::ios::binary);
+    if (!src.file.is_open())
+        return false;
+    src.src_width = width;
+    src.src_height = height;
+    src.target_width = width;
+    src.target_height = height;
+    src.stop = false;
+    src.raw.resize((size_t)width * height * 3 / 2);
+    return true;
+}
+
+// 启动后台读取/缩放线程
+static void yuv_source_start(YuvFrameSource& src) {
+    src.worker = std::thread(yuv_source_worker, &src);
+}
+
+// 设置目标尺寸：不超过源尺寸，且为偶数以保证色度平面对齐
+static void yuv_source_set_target(YuvFrameSource& src, int width, int height) {
+    if (width > src.src_width)
+        width = src.src_width;
+    if (height > src.src_height)
+        height = src.src_height;
+    width = width < 2 ? 2 : width & ~1;
+    height = height < 2 ? 2 : height & ~1;
+    src.target_width = width;
+    src.target_height = height;
+}
+
+// 取走下一帧到 front，必要时等待后台线程完成
+static bool yuv_source_take(YuvFrameSource& src) {
+    std::unique_lock<std::mutex> lock(src.mutex);
+    src.cond.wait(lock, [&]() { return src.ready || src.stop; });
+    if (!src.ready)
+        return false;
+    src.front.swap(src.back);
+    src.front_width = src.back_width;
+    src.front_height = src.back_height;
+    src.ready = false;
+    src.queued.store(0, std::memory_order_relaxed);
+    src.cond.notify_all();
+    return true;
+}
+
+// 停止后台线程并释放资源
+static void yuv_source_close(YuvFrameSource& src) {
+    {
+        std::lock_guard<std::mutex> lock(src.mutex);
+        src.stop = true;
+        src.cond.notify_all();
+    }
+    if (src.worker.joinable())
+        src.worker.join();
+    sws_freeContext(src.sws);
+    src.sws = nullptr;
+    src.file.close();
+}
+
+#endif // YUV_SOURCE_H